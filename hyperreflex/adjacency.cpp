@@ -0,0 +1,83 @@
+#include <hyperreflex/adjacency.hpp>
+//
+#include <hyperreflex/parallel.hpp>
+
+namespace hyperreflex {
+
+auto vertex_adjacency_from(const polyhedral_surface& surface)
+    -> vertex_adjacency {
+  using size_type = vertex_adjacency::size_type;
+  const auto n = surface.vertices.size();
+  const auto m = surface.faces.size();
+
+  // Every face contributes two neighbors for each of its vertices.
+  // Interior edges are shared by two faces and would appear twice.
+  // So, gather all candidates first and remove duplicates afterwards.
+  //
+  vector<atomic<size_type>> counts(n + 1);
+  parallel_for(0, m, [&](size_t i) {
+    for (auto vid : surface.faces[i]) counts[vid + 1] += 2;
+  });
+  vector<size_type> offsets(n + 1);
+  for (size_t i = 0; i < n; ++i) offsets[i + 1] = offsets[i] + counts[i + 1];
+  parallel_for(0, n, [&](size_t i) { counts[i] = offsets[i]; });
+  vector<size_type> candidates(offsets.back());
+  parallel_for(0, m, [&](size_t i) {
+    const auto& f = surface.faces[i];
+    for (size_t j = 0; j < 3; ++j) {
+      const auto k = counts[f[j]].fetch_add(2);
+      candidates[k + 0] = f[(j + 1) % 3];
+      candidates[k + 1] = f[(j + 2) % 3];
+    }
+  });
+
+  // Sort and compact the neighbors of every vertex.
+  //
+  vector<size_type> sizes(n + 1);
+  parallel_for(0, n, [&](size_t i) {
+    const auto first = begin(candidates) + offsets[i];
+    const auto last = begin(candidates) + offsets[i + 1];
+    sort(first, last);
+    sizes[i + 1] = distance(first, unique(first, last));
+  });
+
+  vertex_adjacency result{};
+  result.offsets.resize(n + 1);
+  inclusive_scan(begin(sizes), end(sizes), begin(result.offsets));
+  result.neighbors.resize(result.offsets.back());
+  parallel_for(0, n, [&](size_t i) {
+    copy_n(begin(candidates) + offsets[i], sizes[i + 1],
+           begin(result.neighbors) + result.offsets[i]);
+  });
+  return result;
+}
+
+auto vertex_faces_from(const polyhedral_surface& surface) -> vertex_faces {
+  using size_type = vertex_faces::size_type;
+  const auto n = surface.vertices.size();
+  const auto m = surface.faces.size();
+
+  vector<atomic<size_type>> counts(n + 1);
+  parallel_for(0, m, [&](size_t i) {
+    for (auto vid : surface.faces[i]) ++counts[vid + 1];
+  });
+  vertex_faces result{};
+  result.offsets.resize(n + 1);
+  for (size_t i = 0; i < n; ++i)
+    result.offsets[i + 1] = result.offsets[i] + counts[i + 1];
+  parallel_for(0, n, [&](size_t i) { counts[i] = result.offsets[i]; });
+  result.faces.resize(result.offsets.back());
+  parallel_for(0, m, [&](size_t i) {
+    for (auto vid : surface.faces[i]) result.faces[counts[vid]++] = i;
+  });
+
+  // Concurrent insertion does not preserve the order of faces.
+  //
+  parallel_for(0, n, [&](size_t i) {
+    sort(begin(result.faces) + result.offsets[i],
+         begin(result.faces) + result.offsets[i + 1]);
+  });
+  return result;
+}
+
+}  // namespace hyperreflex
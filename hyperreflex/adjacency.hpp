@@ -0,0 +1,57 @@
+#pragma once
+#include <hyperreflex/polyhedral_surface.hpp>
+
+namespace hyperreflex {
+
+/// Vertex neighborhoods of a polyhedral surface
+/// stored in a compressed row format.
+/// The neighbors of every vertex are sorted and unique.
+///
+struct vertex_adjacency {
+  using size_type = polyhedral_surface::size_type;
+  using vertex_id = polyhedral_surface::vertex_id;
+
+  auto size() const noexcept -> size_t {
+    return offsets.empty() ? 0 : offsets.size() - 1;
+  }
+
+  auto operator()(vertex_id vid) const noexcept {
+    return span{neighbors.data() + offsets[vid],
+                neighbors.data() + offsets[vid + 1]};
+  }
+
+  vector<size_type> offsets{};
+  vector<vertex_id> neighbors{};
+};
+
+/// Construct the vertex adjacency of a surface in parallel.
+///
+auto vertex_adjacency_from(const polyhedral_surface& surface)
+    -> vertex_adjacency;
+
+/// Faces around every vertex of a polyhedral surface
+/// stored in a compressed row format.
+/// The faces of every vertex are sorted.
+///
+struct vertex_faces {
+  using size_type = polyhedral_surface::size_type;
+  using vertex_id = polyhedral_surface::vertex_id;
+  using face_id = polyhedral_surface::face_id;
+
+  auto size() const noexcept -> size_t {
+    return offsets.empty() ? 0 : offsets.size() - 1;
+  }
+
+  auto operator()(vertex_id vid) const noexcept {
+    return span{faces.data() + offsets[vid], faces.data() + offsets[vid + 1]};
+  }
+
+  vector<size_type> offsets{};
+  vector<face_id> faces{};
+};
+
+/// Construct the faces around all vertices of a surface in parallel.
+///
+auto vertex_faces_from(const polyhedral_surface& surface) -> vertex_faces;
+
+}  // namespace hyperreflex
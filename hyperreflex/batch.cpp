@@ -0,0 +1,160 @@
+#include <hyperreflex/batch.hpp>
+//
+#include <hyperreflex/parallel.hpp>
+#include <hyperreflex/welding.hpp>
+
+namespace hyperreflex {
+
+namespace {
+
+// Quote a CSV field when it contains separators, quotes, or line breaks.
+//
+auto csv_field(const string& str) -> string {
+  if (str.find_first_of(",\"\n\r") == string::npos) return str;
+  string result = "\"";
+  for (auto c : str) {
+    if (c == '"') result += '"';
+    result += c;
+  }
+  return result + '"';
+}
+
+// Count boundary and non-manifold edges by sorting all undirected edges.
+//
+void count_edges(const polyhedral_surface& surface, batch_statistics& stats) {
+  vector<uint64> edges(3 * surface.faces.size());
+  parallel_for(0, surface.faces.size(), [&](size_t i) {
+    const auto& f = surface.faces[i];
+    for (size_t j = 0; j < 3; ++j) {
+      const auto [a, b] = minmax(f[j], f[(j + 1) % 3]);
+      edges[3 * i + j] = (uint64(a) << 32) | b;
+    }
+  });
+  ranges::sort(edges);
+  for (size_t i = 0; i < edges.size();) {
+    size_t j = i + 1;
+    while ((j < edges.size()) && (edges[j] == edges[i])) ++j;
+    if (j - i == 1) ++stats.boundary_edges;
+    if (j - i > 2) ++stats.nonmanifold_edges;
+    i = j;
+  }
+}
+
+}  // namespace
+
+auto operator<<(ostream& os, const batch_statistics& stats) -> ostream& {
+  return os << csv_field(stats.path.string()) << ','
+            << (stats.error.empty() ? "ok" : "error") << ',' << stats.load_time
+            << ',' << stats.weld_time << ',' << stats.loaded_vertices << ','
+            << stats.vertices << ',' << stats.triangles << ','
+            << stats.degenerate_triangles << ',' << stats.boundary_edges << ','
+            << stats.nonmanifold_edges << ',' << stats.surface_bytes << ','
+            << csv_field(stats.error);
+}
+
+auto is_mesh_file(const filesystem::path& path) -> bool {
+  static constexpr czstring extensions[] = {
+      ".stl", ".obj", ".ply", ".off", ".3ds", ".dae", ".fbx", ".gltf", ".glb"};
+  auto extension = path.extension().string();
+  for (auto& c : extension) c = tolower(c);
+  return ranges::find(extensions, string_view{extension}) != end(extensions);
+}
+
+auto batch_files_from(const filesystem::path& path)
+    -> vector<filesystem::path> {
+  vector<filesystem::path> files{};
+
+  if (is_directory(path)) {
+    for (const auto& entry : filesystem::recursive_directory_iterator(path))
+      if (entry.is_regular_file() && is_mesh_file(entry.path()))
+        files.push_back(entry.path());
+    // The traversal order of directories is unspecified.
+    ranges::sort(files);
+    return files;
+  }
+
+  fstream list{path, ios::in};
+  if (!list.is_open())
+    throw runtime_error("Failed to open file list '"s + path.string() + "'.");
+  for (string line; getline(list, line);) {
+    if (!line.empty() && (line.back() == '\r')) line.pop_back();
+    if (line.empty()) continue;
+    filesystem::path file{line};
+    if (file.is_relative()) file = path.parent_path() / file;
+    files.push_back(file);
+  }
+  return files;
+}
+
+auto batch_statistics_from(const filesystem::path& path) -> batch_statistics {
+  batch_statistics stats{.path = path};
+  try {
+    const auto bytes = [](const polyhedral_surface& s) {
+      return s.vertices.size() * sizeof(polyhedral_surface::vertex) +
+             s.faces.size() * sizeof(polyhedral_surface::face);
+    };
+    polyhedral_surface surface{};
+    size_t triangles{};
+    const auto load_start = clock::now();
+    if (is_stl_file(path) && (file_size(path) >= stl_streaming_threshold)) {
+      // Huge STL files are streamed and welded on the fly.
+      // Loading and welding can then not be timed separately.
+      //
+      auto data = welded_stl_surface_from(path);
+      const auto load_end = clock::now();
+      stats.load_time = duration<float32>(load_end - load_start).count();
+      stats.loaded_vertices = data.corner_count;
+      triangles = data.corner_count / 3;
+      surface = std::move(data.surface);
+      stats.surface_bytes = bytes(surface);
+    } else {
+      const auto data = polyhedral_surface_from(path);
+      const auto load_end = clock::now();
+      surface = welded(data);
+      const auto weld_end = clock::now();
+      stats.load_time = duration<float32>(load_end - load_start).count();
+      stats.weld_time = duration<float32>(weld_end - load_end).count();
+      stats.loaded_vertices = data.vertices.size();
+      triangles = data.faces.size();
+      stats.surface_bytes = bytes(data) + bytes(surface);
+    }
+    stats.vertices = surface.vertices.size();
+    stats.triangles = surface.faces.size();
+    stats.degenerate_triangles = triangles - surface.faces.size();
+
+    // Validation
+    //
+    for (size_t i = 0; i < surface.vertices.size(); ++i) {
+      const auto& p = surface.vertices[i].position;
+      if (!isfinite(p.x) || !isfinite(p.y) || !isfinite(p.z))
+        throw runtime_error("Vertex " + to_string(i) +
+                            " has a non-finite position.");
+    }
+    count_edges(surface, stats);
+  } catch (const exception& e) {
+    stats.error = e.what();
+  }
+  return stats;
+}
+
+void batch_process(span<const filesystem::path> files,
+                   size_t workers,
+                   const function<void(const batch_statistics&)>& callback) {
+  atomic<size_t> next = 0;
+  mutex callback_mutex{};
+  workers = std::clamp(workers, size_t{1}, std::max(files.size(), size_t{1}));
+  // The loaders and the welder are parallel on their own.
+  // Every worker only gets its share of the threads for them.
+  // So, the total number of threads stays bounded by the thread count.
+  const auto threads = std::max(thread_count() / workers, size_t{1});
+  parallel_invoke(workers, [&](size_t) {
+    const thread_limit_guard limit{threads};
+    for (auto i = next++; i < files.size(); i = next++) {
+      const auto stats = batch_statistics_from(files[i]);
+      scoped_lock lock{callback_mutex};
+      callback(stats);
+    }
+  });
+}
+
+}  // namespace hyperreflex
@@ -0,0 +1,61 @@
+#pragma once
+#include <hyperreflex/polyhedral_surface.hpp>
+
+namespace hyperreflex {
+
+/// Statistics of loading, welding, and validating a single mesh file.
+///
+struct batch_statistics {
+  filesystem::path path{};
+  // Empty for successfully processed files
+  string error{};
+
+  float32 load_time{};
+  float32 weld_time{};
+  size_t loaded_vertices{};
+  size_t vertices{};
+  // Triangles after welding and the ones removed as degenerate
+  size_t triangles{};
+  size_t degenerate_triangles{};
+  // Edges with one and with more than two adjacent triangles
+  size_t boundary_edges{};
+  size_t nonmanifold_edges{};
+  // Bytes of the arrays of the loaded and the welded surface.
+  // This is not the peak memory of the process
+  // which is shared by all concurrent workers.
+  size_t surface_bytes{};
+
+  static constexpr czstring csv_header =
+      "path,status,load_time,weld_time,loaded_vertices,vertices,triangles,"
+      "degenerate_triangles,boundary_edges,nonmanifold_edges,surface_bytes,"
+      "error";
+};
+
+auto operator<<(ostream& os, const batch_statistics& stats) -> ostream&;
+
+/// Check whether the given path uses the file extension of a mesh file.
+///
+auto is_mesh_file(const filesystem::path& path) -> bool;
+
+/// Get all mesh files to be processed for the given path.
+/// Directories are searched recursively for mesh files.
+/// All other files are read as lists with one path per line.
+/// Relative paths in lists are relative to the list itself.
+///
+auto batch_files_from(const filesystem::path& path)
+    -> vector<filesystem::path>;
+
+/// Load, weld, and validate a mesh file.
+/// Errors are not thrown but reported in the statistics.
+///
+auto batch_statistics_from(const filesystem::path& path) -> batch_statistics;
+
+/// Process all files concurrently by a bounded number of worker threads.
+/// Every worker fetches the next file as soon as it has finished the last one.
+/// The callback is serialized and receives statistics in completion order.
+///
+void batch_process(span<const filesystem::path> files,
+                   size_t workers,
+                   const function<void(const batch_statistics&)>& callback);
+
+}  // namespace hyperreflex
@@ -0,0 +1,1016 @@
+#include <hyperreflex/adjacency.hpp>
+#include <hyperreflex/bvh.hpp>
+#include <hyperreflex/compressed_bvh.hpp>
+#include <hyperreflex/heat_cache.hpp>
+#include <hyperreflex/kd_tree.hpp>
+#include <hyperreflex/local_heat_method.hpp>
+#include <hyperreflex/obj_surface.hpp>
+#include <hyperreflex/parallel.hpp>
+#include <hyperreflex/ply_surface.hpp>
+#include <hyperreflex/renderer.hpp>
+#include <hyperreflex/stl_binary_view.hpp>
+#include <hyperreflex/stl_surface.hpp>
+#include <hyperreflex/welding.hpp>
+//
+#include <random>
+//
+#include <igl/heat_geodesics.h>
+
+using namespace std;
+using namespace hyperreflex;
+
+namespace {
+
+// Measure the minimal wall-clock time of a function over several runs.
+// The minimum is the most stable estimate for I/O and memory-bound code.
+//
+auto min_time(auto&& function, int runs = 5) {
+  auto result = numeric_limits<float64>::infinity();
+  for (int i = 0; i < runs; ++i) {
+    const auto start = hyperreflex::clock::now();
+    function();
+    const auto end = hyperreflex::clock::now();
+    result = std::min(result, duration<float64>(end - start).count());
+  }
+  return result;
+}
+
+void report(czstring name, float64 time, size_t bytes) {
+  cout << setw(30) << name << " = " << setw(10) << setprecision(3) << fixed
+       << time << " s" << setw(10) << bytes / time / 1e9 << " GB/s\n";
+}
+
+// The previous binary STL loader which reads every record
+// with two stream calls is kept here as reference.
+//
+auto fstream_stl_triangles(const filesystem::path& path) {
+  fstream file{path, ios::in | ios::binary};
+  if (!file.is_open())
+    throw runtime_error("Failed to open STL file from path '"s + path.string() +
+                        "'.");
+  file.ignore(sizeof(stl_surface::header));
+  stl_surface::size_type size;
+  file.read((char*)&size, sizeof(size));
+  vector<stl_surface::triangle> triangles(size);
+  for (auto& t : triangles) {
+    file.read((char*)&t, sizeof(t));
+    file.ignore(sizeof(stl_surface::attribute_byte_count_type));
+  }
+  return triangles;
+}
+
+void stl_load(const filesystem::path& path) {
+  const auto bytes = file_size(path);
+  cout << "binary STL load of " << path << " (" << bytes << " bytes)\n";
+
+  size_t check = 0;
+  report("fstream loop", min_time([&] {
+           check += fstream_stl_triangles(path).size();
+         }),
+         bytes);
+  report("stl_binary_view decode", min_time([&] {
+           const stl_binary_view view{path};
+           vector<stl_surface::triangle> triangles(view.size());
+           view.decode(0, view.size(), triangles.data());
+           check += triangles.size();
+         }),
+         bytes);
+  report("stl_binary_view streams", min_time([&] {
+           const stl_binary_view view{path};
+           vector<vec3> positions(3 * size_t(view.size()));
+           vector<vec3> normals(view.size());
+           view.decode(0, view.size(), positions.data(), normals.data());
+           check += normals.size();
+         }),
+         bytes);
+  // Make sure the loaded data cannot be optimized away.
+  cout << "(" << check << " triangles in total)\n";
+}
+
+void obj_load(const filesystem::path& path) {
+  const auto bytes = file_size(path);
+  cout << "OBJ load of " << path << " (" << bytes << " bytes)\n";
+
+  size_t check = 0;
+  report("native OBJ loader", min_time([&] {
+           check += polyhedral_surface_from_obj_file(path).faces.size();
+         }),
+         bytes);
+  // Make sure the loaded data cannot be optimized away.
+  cout << "(" << check << " triangles in total)\n";
+}
+
+void ply_load_save(const filesystem::path& path) {
+  const auto bytes = file_size(path);
+  cout << "PLY load and save of " << path << " (" << bytes << " bytes)\n";
+
+  size_t check = 0;
+  report("native PLY loader", min_time([&] {
+           check += polyhedral_surface_from_ply_file(path).faces.size();
+         }),
+         bytes);
+
+  const auto surface = polyhedral_surface_from_ply_file(path);
+  auto output = path;
+  output += ".benchmark.ply";
+  const auto time = min_time([&] { save_ply_file(surface, output); });
+  report("native PLY writer", time, file_size(output));
+  remove(output);
+
+  // Make sure the loaded data cannot be optimized away.
+  cout << "(" << check << " triangles in total)\n";
+}
+
+// Rays starting on a sphere around the surface
+// and pointing to random points inside its bounding box.
+// A fixed seed makes all runs comparable.
+//
+auto random_rays(const polyhedral_surface& surface, size_t count) {
+  const auto box = aabb_from(surface);
+  mt19937 rng{12345};
+  uniform_real_distribution<float32> uniform{0.0f, 1.0f};
+  const auto random_vec3 = [&] {
+    return vec3{uniform(rng), uniform(rng), uniform(rng)};
+  };
+  vector<ray> rays(count);
+  for (auto& r : rays) {
+    const auto direction = normalize(random_vec3() - 0.5f);
+    r.origin = box.origin() + 2.0f * box.radius() * direction;
+    const auto target = box._min + random_vec3() * (box._max - box._min);
+    r.direction = normalize(target - r.origin);
+  }
+  return rays;
+}
+
+// Primary rays of a pinhole camera looking diagonally onto the surface
+// with one ray per pixel in scanline order.
+//
+auto camera_rays(const polyhedral_surface& surface, size_t resolution) {
+  const auto box = aabb_from(surface);
+  const auto front = -normalize(vec3{1, 1, 1});
+  const auto right = normalize(cross(front, vec3{0, 1, 0}));
+  const auto up = cross(right, front);
+  const auto origin = box.origin() - 3.0f * box.radius() * front;
+  vector<ray> rays(resolution * resolution);
+  for (size_t i = 0; i < resolution; ++i) {
+    for (size_t j = 0; j < resolution; ++j) {
+      const auto x = (j + 0.5f) / resolution - 0.5f;
+      const auto y = (i + 0.5f) / resolution - 0.5f;
+      rays[i * resolution + j] = {
+          origin, normalize(1.5f * front + x * right + y * up)};
+    }
+  }
+  return rays;
+}
+
+void report_rays(czstring name, float64 time, size_t rays) {
+  cout << setw(30) << name << " = " << setw(10) << setprecision(3) << fixed
+       << time << " s" << setw(10) << setprecision(4) << defaultfloat
+       << rays / time / 1e6 << " Mrays/s\n";
+}
+
+void report_queries(czstring name, float64 time, size_t queries) {
+  cout << setw(30) << name << " = " << setw(10) << setprecision(3) << fixed
+       << time << " s" << setw(10) << setprecision(4) << defaultfloat
+       << queries / time / 1e6 << " Mqueries/s\n";
+}
+
+// Count the results that are not bitwise equal to their reference.
+// Only the first results are compared if there are fewer references.
+//
+void report_mismatches(
+    const vector<ray_polyhedral_surface_intersection>& reference,
+    const vector<ray_polyhedral_surface_intersection>& results) {
+  size_t mismatches = 0;
+  size_t hits = 0;
+  for (size_t i = 0; i < reference.size(); ++i) {
+    const auto& x = reference[i];
+    const auto& y = results[i];
+    hits += bool(x);
+    if ((x.f != y.f) || (x && ((x.t != y.t) || (x.u != y.u) || (x.v != y.v))))
+      ++mismatches;
+  }
+  cout << "(" << hits << " hits and " << mismatches << " mismatches in "
+       << reference.size() << " compared rays)\n";
+}
+
+void bvh_intersection(const filesystem::path& path) {
+  const auto surface = welded(polyhedral_surface_from(path));
+  cout << "BVH intersection on " << path << " (" << surface.faces.size()
+       << " faces)\n";
+
+  bvh tree{};
+  const auto build_time = min_time([&] { tree = bvh_from(surface); }, 3);
+  cout << setw(30) << "BVH build" << " = " << setw(10) << setprecision(3)
+       << fixed << build_time << " s" << setw(10) << tree.nodes.size()
+       << " nodes\n";
+
+  // The brute-force query is way too slow for the same number of rays.
+  const size_t rays_count = 1 << 20;
+  const auto brute_force_count = std::clamp(
+      size_t(1e9 / std::max(surface.faces.size(), size_t{1})), size_t{16},
+      rays_count);
+  const auto rays = random_rays(surface, rays_count);
+
+  vector<ray_polyhedral_surface_intersection> brute_force(brute_force_count);
+  report_rays("brute force", min_time([&] {
+                for (size_t i = 0; i < brute_force_count; ++i)
+                  brute_force[i] = intersection(rays[i], surface);
+              }, 1),
+              brute_force_count);
+
+  vector<ray_polyhedral_surface_intersection> results(rays_count);
+  report_rays("BVH", min_time([&] {
+                for (size_t i = 0; i < rays_count; ++i)
+                  results[i] = intersection(rays[i], tree);
+              }),
+              rays_count);
+
+  // Both queries need to provide the exact same results.
+  report_mismatches(brute_force, results);
+}
+
+// Compare the scalar test of every single triangle
+// with the SIMD kernel for all supported widths.
+//
+void simd_intersection(const filesystem::path& path) {
+  const auto surface = welded(polyhedral_surface_from(path));
+  cout << "SIMD intersection on " << path << " (" << surface.faces.size()
+       << " faces, native width " << simd_width() << ")\n";
+
+  const size_t rays_count = 1 << 20;
+  const auto brute_force_count = std::clamp(
+      size_t(1e9 / std::max(surface.faces.size(), size_t{1})), size_t{16},
+      rays_count);
+  const auto rays = random_rays(surface, rays_count);
+  const auto& v = surface.vertices;
+
+  vector<ray_polyhedral_surface_intersection> scalar(brute_force_count);
+  report_rays("scalar brute force", min_time([&] {
+                for (size_t i = 0; i < brute_force_count; ++i) {
+                  auto& result = scalar[i];
+                  result = {};
+                  result.t = infinity;
+                  for (size_t f = 0; f < surface.faces.size(); ++f) {
+                    const auto& face = surface.faces[f];
+                    const auto p = intersection(
+                        rays[i], triangle{v[face[0]].position,
+                                          v[face[1]].position,
+                                          v[face[2]].position});
+                    if (!p || (p.t >= result.t)) continue;
+                    static_cast<ray_triangle_intersection&>(result) = p;
+                    result.f = f;
+                  }
+                }
+              }, 1),
+              brute_force_count);
+
+  vector<ray_polyhedral_surface_intersection> results(rays_count);
+  report_rays("SIMD brute force", min_time([&] {
+                for (size_t i = 0; i < brute_force_count; ++i)
+                  results[i] = intersection(rays[i], surface);
+              }, 1),
+              brute_force_count);
+  report_mismatches(scalar, results);
+
+  for (size_t width = 4; width <= simd_width(); width *= 2) {
+    triangle_blocks blocks(width, (surface.faces.size() + width - 1) / width);
+    for (size_t f = 0; f < surface.faces.size(); ++f) {
+      const auto& face = surface.faces[f];
+      blocks.set(f / width, f % width,
+                 {v[face[0]].position, v[face[1]].position,
+                  v[face[2]].position},
+                 f);
+    }
+    const auto name = "blocks of " + to_string(width);
+    report_rays(name.c_str(), min_time([&] {
+                  for (size_t i = 0; i < brute_force_count; ++i)
+                    results[i] = intersection(rays[i], blocks);
+                }, 1),
+                brute_force_count);
+    report_mismatches(scalar, results);
+
+    const auto tree = bvh_from(surface, width);
+    const auto bvh_name = "BVH with blocks of " + to_string(width);
+    report_rays(bvh_name.c_str(), min_time([&] {
+                  for (size_t i = 0; i < rays_count; ++i)
+                    results[i] = intersection(rays[i], tree);
+                }),
+                rays_count);
+    report_mismatches(scalar, results);
+  }
+}
+
+// Throughput of the batched ray queries in comparison
+// to single-ray queries in the given order on one thread.
+//
+void batched_intersection(const filesystem::path& path) {
+  const auto surface = welded(polyhedral_surface_from(path));
+  cout << "Batched intersection on " << path << " (" << surface.faces.size()
+       << " faces, " << thread_count() << " threads)\n";
+  const auto tree = bvh_from(surface);
+
+  const auto run = [&](czstring name, const vector<ray>& rays) {
+    vector<ray_polyhedral_surface_intersection> single(rays.size());
+    const auto single_name = name + " single"s;
+    report_rays(single_name.c_str(), min_time([&] {
+                  for (size_t i = 0; i < rays.size(); ++i)
+                    single[i] = intersection(rays[i], tree);
+                }, 3),
+                rays.size());
+
+    vector<ray_polyhedral_surface_intersection> batched(rays.size());
+    const auto batched_name = name + " batched"s;
+    report_rays(batched_name.c_str(),
+                min_time([&] { intersect(tree, rays, batched); }, 3),
+                rays.size());
+    report_mismatches(single, batched);
+  };
+
+  run("random", random_rays(surface, 1 << 20));
+  run("camera", camera_rays(surface, 1024));
+
+  // Shuffled camera rays show the benefit of sorting.
+  auto rays = camera_rays(surface, 1024);
+  shuffle(begin(rays), end(rays), mt19937{12345});
+  run("shuffled camera", rays);
+}
+
+// Visibility checks by the any-hit query in comparison
+// to checking the distance of the closest hit.
+//
+void occlusion(const filesystem::path& path) {
+  const auto surface = welded(polyhedral_surface_from(path));
+  cout << "Occlusion on " << path << " (" << surface.faces.size()
+       << " faces, " << thread_count() << " threads)\n";
+  const auto tree = bvh_from(surface);
+
+  // Segments from the sphere of origins to random points
+  // inside the bounding box of the surface.
+  const size_t count = 1 << 20;
+  const auto rays = random_rays(surface, count);
+  const auto box = aabb_from(surface);
+  mt19937 rng{54321};
+  uniform_real_distribution<float32> uniform{0.0f, 4.0f * box.radius()};
+  vector<float32> tmax(count);
+  for (auto& t : tmax) t = uniform(rng);
+
+  const auto run = [&](czstring name, auto&& function) {
+    auto results = make_unique<bool[]>(count);
+    report_rays(name, min_time([&] { function(results.get()); }, 3), count);
+    return results;
+  };
+  const auto reference = run("closest hit", [&](bool* results) {
+    for (size_t i = 0; i < count; ++i)
+      results[i] = intersection(rays[i], tree).t < tmax[i];
+  });
+  const auto single = run("any hit", [&](bool* results) {
+    for (size_t i = 0; i < count; ++i)
+      results[i] = occluded(rays[i], tree, tmax[i]);
+  });
+  const auto batched = run("batched any hit", [&](bool* results) {
+    occluded(tree, rays, tmax, {results, count});
+  });
+
+  size_t occluded_count = 0;
+  size_t mismatches = 0;
+  for (size_t i = 0; i < count; ++i) {
+    occluded_count += reference[i];
+    mismatches += (single[i] != reference[i]) + (batched[i] != reference[i]);
+  }
+  cout << "(" << occluded_count << " occluded and " << mismatches
+       << " mismatches in " << count << " compared rays)\n";
+}
+
+// Displacing all vertices along their normals like the viewer does
+// and updating the BVH by a refit instead of a new build.
+//
+void bvh_refit(const filesystem::path& path) {
+  auto surface = welded(polyhedral_surface_from(path));
+  compute_vertex_normals(surface);
+  cout << "BVH refit on " << path << " (" << surface.faces.size()
+       << " faces, " << thread_count() << " threads)\n";
+  const auto tree = bvh_from(surface);
+
+  // A smooth potential along the longest axis of the bounding box
+  // moves one side of the surface outwards and the other one inwards.
+  const auto box = aabb_from(surface);
+  const auto extent = box._max - box._min;
+  const int axis = (extent.x >= extent.y) ? ((extent.x >= extent.z) ? 0 : 2)
+                                          : ((extent.y >= extent.z) ? 1 : 2);
+  auto displaced = surface;
+  for (auto& v : displaced.vertices) {
+    const auto x = (v.position[axis] - box._min[axis]) / extent[axis];
+    v.position += 0.5f * box.radius() * sin(6.0f * x) * v.normal;
+  }
+
+  const auto report_time = [](czstring name, float64 time) {
+    cout << setw(30) << name << " = " << setw(10) << setprecision(3) << fixed
+         << time << " s\n";
+  };
+  bvh fresh{};
+  report_time("build", min_time([&] { fresh = bvh_from(displaced); }, 3));
+  // Without rebuilds, a refit only depends on the vertices.
+  auto refitted = tree;
+  report_time("refit", min_time([&] {
+                refit(refitted, displaced.vertices, displaced.faces);
+              }, 3));
+  auto rebuilt = tree;
+  size_t rebuilds = 0;
+  report_time("refit and rebuild", min_time([&] {
+                rebuilds =
+                    refit(rebuilt, displaced.vertices, displaced.faces, 1.5f);
+              }, 1));
+  cout << "(" << rebuilds << " rebuilt subtrees)\n";
+
+  const size_t rays_count = 1 << 20;
+  const auto rays = random_rays(displaced, rays_count);
+  const auto run = [&](czstring name, const bvh& tree) {
+    vector<ray_polyhedral_surface_intersection> results(rays_count);
+    report_rays(name, min_time([&] {
+                  for (size_t i = 0; i < rays_count; ++i)
+                    results[i] = intersection(rays[i], tree);
+                }, 3),
+                rays_count);
+    return results;
+  };
+  const auto reference = run("built", fresh);
+  report_mismatches(reference, run("refitted", refitted));
+  report_mismatches(reference, run("refitted and rebuilt", rebuilt));
+}
+
+// Build time, memory, and traversal speed of the compressed BVH
+// side by side with the binary BVH whose results serve as reference.
+//
+void compressed_intersection(const filesystem::path& path) {
+  const auto surface = welded(polyhedral_surface_from(path));
+  cout << "Compressed BVH on " << path << " (" << surface.faces.size()
+       << " faces, native width " << simd_width() << ")\n";
+
+  const auto report_build = [&](czstring name, float64 time, size_t bytes) {
+    cout << setw(30) << name << " = " << setw(10) << setprecision(3) << fixed
+         << time << " s" << setw(10) << setprecision(4) << defaultfloat
+         << float64(bytes) / surface.faces.size() << " B/face"
+         << setw(10) << bytes / 1e6 << " MB\n";
+  };
+
+  bvh tree{};
+  const auto build_time = min_time([&] { tree = bvh_from(surface); }, 3);
+  report_build("BVH build", build_time, memory_usage(tree));
+  compressed_bvh compressed{};
+  const auto compressed_build_time =
+      min_time([&] { compressed = compressed_bvh_from(surface); }, 3);
+  report_build("compressed BVH build", compressed_build_time,
+               memory_usage(compressed));
+
+  const auto run = [&](czstring name, const vector<ray>& rays) {
+    vector<ray_polyhedral_surface_intersection> reference(rays.size());
+    const auto binary_name = name + " BVH"s;
+    report_rays(binary_name.c_str(), min_time([&] {
+                  for (size_t i = 0; i < rays.size(); ++i)
+                    reference[i] = intersection(rays[i], tree);
+                }, 3),
+                rays.size());
+
+    vector<ray_polyhedral_surface_intersection> results(rays.size());
+    const auto compressed_name = name + " compressed BVH"s;
+    report_rays(compressed_name.c_str(), min_time([&] {
+                  for (size_t i = 0; i < rays.size(); ++i)
+                    results[i] = intersection(rays[i], compressed, surface);
+                }, 3),
+                rays.size());
+    report_mismatches(reference, results);
+  };
+
+  run("random", random_rays(surface, 1 << 20));
+  run("camera", camera_rays(surface, 1024));
+}
+
+// Work per ray of the acceleration structures with all block widths
+// counted by the ray statistics which have to be enabled for the build.
+//
+void ray_tracing_statistics(const filesystem::path& path) {
+  const auto surface = welded(polyhedral_surface_from(path));
+  cout << "Ray statistics on " << path << " (" << surface.faces.size()
+       << " faces, " << thread_count() << " threads)\n";
+  if constexpr (!ray_statistics_enabled) {
+    cout << "Ray statistics are disabled. "
+            "Build with 'config.hyperreflex.ray_statistics=true'.\n";
+    return;
+  }
+
+  const auto run = [&](const string& name, auto&& query) {
+    for (const auto& [rays_name, rays] :
+         {pair{"random", random_rays(surface, 1 << 20)},
+          pair{"camera", camera_rays(surface, 1024)}}) {
+      reset_ray_statistics();
+      vector<ray_polyhedral_surface_intersection> results(rays.size());
+      for (size_t i = 0; i < rays.size(); ++i) results[i] = query(rays[i]);
+      cout << setw(30) << (rays_name + (" " + name)) << " = "
+           << setprecision(3) << fixed << total_ray_statistics() << '\n';
+    }
+  };
+
+  for (size_t width = 4; width <= simd_width(); width *= 2) {
+    const auto tree = bvh_from(surface, width);
+    run("BVH " + to_string(width),
+        [&](const ray& r) { return intersection(r, tree); });
+  }
+  const auto compressed = compressed_bvh_from(surface);
+  run("compressed BVH",
+      [&](const ray& r) { return intersection(r, compressed, surface); });
+}
+
+// Precomputation of the heat method compared to loading it from its cache
+//
+void heat_precomputation(const filesystem::path& path) {
+  const auto surface = welded(polyhedral_surface_from(path));
+  cout << "Heat method on " << path << " (" << surface.vertices.size()
+       << " vertices, " << surface.faces.size() << " faces)\n";
+  const auto report_time = [](czstring name, float64 time) {
+    cout << setw(30) << name << " = " << setw(10) << setprecision(3) << fixed
+         << time << " s\n";
+  };
+
+  const auto time_step = heat_time_step(surface);
+  uint64 key{};
+  report_time("cache key",
+              min_time([&] { key = heat_cache::key_of(surface, time_step); }));
+  const auto topology_key = heat_cache::topology_key_of(surface);
+
+  heat_method method{};
+  report_time("precomputation", min_time([&] {
+                method = heat_method_from(surface, time_step);
+              }, 1));
+
+  // The cache is written next to the mesh under another name.
+  auto source = path;
+  source += ".benchmark";
+  const auto cache_path = heat_cache::path_of(source);
+  report_time("cache save",
+              min_time([&] {
+                save_heat_cache(source, key, topology_key, method);
+              }, 1));
+  cout << setw(30) << "cache size" << " = " << setw(10) << setprecision(3)
+       << file_size(cache_path) / 1e6 << " MB\n";
+  optional<heat_method> cache{};
+  report_time("cache load",
+              min_time([&] { cache = load_heat_cache(source, key); }, 3));
+  optional<heat_analysis> analysis{};
+  report_time("cached analysis load", min_time([&] {
+                analysis = load_heat_analysis(source, topology_key);
+              }, 3));
+  remove(cache_path);
+  if (!cache) {
+    cout << "(cache could not be loaded)\n";
+    return;
+  }
+
+  const array<polyhedral_surface::vertex_id, 1> sources{0};
+  vector<float32> distances{};
+  report_time("solve", min_time([&] {
+                distances = geodesic_distances(method, surface, sources);
+              }, 3));
+  const auto cached = geodesic_distances(*cache, surface, sources);
+  cout << "(" << ((distances == cached) ? "identical" : "different")
+       << " distances from the cache)\n";
+}
+
+// Factorization and solve of the heat method with the given scalar type
+// reusing the symbolic analysis
+//
+template <typename real>
+auto heat_solver(const polyhedral_surface& surface,
+                 float64 time_step,
+                 const heat_analysis& analysis,
+                 const string& name) {
+  const auto report_time = [&](const string& step, float64 time) {
+    cout << setw(30) << (name + " " + step) << " = " << setw(10)
+         << setprecision(3) << fixed << time << " s\n";
+  };
+  basic_heat_method<real> method{};
+  report_time("factorization", min_time([&] {
+                method = heat_method_from<real>(surface, time_step, analysis);
+              }, 1));
+  cout << setw(30) << (name + " factor size") << " = " << setw(10)
+       << setprecision(3)
+       << (method.heat_flow.values.size() * sizeof(float64) +
+           method.poisson.values.size() * sizeof(real)) /
+              1e6
+       << " MB\n";
+
+  const array<polyhedral_surface::vertex_id, 1> sources{0};
+  vector<real> distances{};
+  report_time("solve", min_time([&] {
+                distances = geodesic_distances(method, surface, sources);
+              }, 3));
+  return vector<float64>(begin(distances), end(distances));
+}
+
+// Supernodal heat method with a single- and double-precision Poisson problem
+// compared to the double-precision heat method of libigl.
+// Differences are given relative to the largest distance.
+//
+void heat_solvers(const filesystem::path& path) {
+  const auto surface = welded(polyhedral_surface_from(path));
+  cout << "Heat method solvers on " << path << " (" << surface.vertices.size()
+       << " vertices, " << surface.faces.size() << " faces)\n";
+  const auto report_time = [](czstring name, float64 time) {
+    cout << setw(30) << name << " = " << setw(10) << setprecision(3) << fixed
+         << time << " s\n";
+  };
+  const auto time_step = heat_time_step(surface);
+
+  heat_analysis analysis{};
+  report_time("symbolic analysis",
+              min_time([&] { analysis = heat_analysis_from(surface); }, 1));
+  const auto single = heat_solver<float32>(surface, time_step, analysis,
+                                           "float32");
+  const auto reference = heat_solver<float64>(surface, time_step, analysis,
+                                              "float64");
+
+  Eigen::MatrixXd vertices(surface.vertices.size(), 3);
+  for (size_t i = 0; const auto& v : surface.vertices) {
+    vertices.row(i++) << v.position.x, v.position.y, v.position.z;
+  }
+  Eigen::MatrixXi faces(surface.faces.size(), 3);
+  for (size_t i = 0; const auto& f : surface.faces) {
+    faces.row(i++) << f[0], f[1], f[2];
+  }
+  igl::HeatGeodesicsData<double> data{};
+  report_time("libigl precomputation", min_time([&] {
+                igl::heat_geodesics_precompute(vertices, faces, time_step,
+                                               data);
+              }, 1));
+  Eigen::VectorXi gamma(1);
+  gamma << 0;
+  Eigen::VectorXd distances{};
+  report_time("libigl solve", min_time([&] {
+                igl::heat_geodesics_solve(data, gamma, distances);
+              }, 3));
+  const vector<float64> libigl(distances.data(),
+                               distances.data() + distances.size());
+
+  const auto difference = [&](const vector<float64>& x) {
+    float64 error = 0;
+    for (size_t i = 0; i < x.size(); ++i)
+      error = std::max(error, abs(x[i] - reference[i]));
+    return error / std::max(ranges::max(reference), float64{1e-30});
+  };
+  cout << setprecision(6) << "(float32 differs by " << difference(single)
+       << " and libigl by " << difference(libigl) << " from float64)\n";
+}
+
+// A line along the edges from the first vertex
+// to the last vertex reached by a breadth-first search
+//
+auto breadth_first_line(const polyhedral_surface& surface) {
+  using vertex_id = polyhedral_surface::vertex_id;
+  const auto adjacency = vertex_adjacency_from(surface);
+  vector<vertex_id> parents(surface.vertices.size(),
+                            polyhedral_surface::invalid);
+  vector<vertex_id> queue{0};
+  parents[0] = 0;
+  for (size_t i = 0; i < queue.size(); ++i) {
+    for (auto vid : adjacency(queue[i])) {
+      if (parents[vid] != polyhedral_surface::invalid) continue;
+      parents[vid] = queue[i];
+      queue.push_back(vid);
+    }
+  }
+  vector<vertex_id> result{queue.back()};
+  while (result.back() != 0) result.push_back(parents[result.back()]);
+  ranges::reverse(result);
+  return result;
+}
+
+// Distances to a line that grows segment by segment like in the viewer.
+// Either the heat of the whole line is diffused for every segment
+// or only the heat of the segment's vertices is added.
+//
+void incremental_heat(const filesystem::path& path) {
+  const auto surface = welded(polyhedral_surface_from(path));
+  const auto method = heat_method_from(surface, heat_time_step(surface));
+  const auto line = breadth_first_line(surface);
+  const size_t segments = std::min(line.size(), size_t{16});
+  cout << "Incremental heat on " << path << " (" << surface.vertices.size()
+       << " vertices, " << line.size() << " line vertices, " << segments
+       << " segments)\n";
+  const auto report_time = [&](czstring name, float64 time) {
+    cout << setw(30) << name << " = " << setw(10) << setprecision(3) << fixed
+         << time / segments << " s/segment\n";
+  };
+  const auto prefix = [&](size_t i) {
+    return span{line}.first((i + 1) * line.size() / segments);
+  };
+
+  vector<vector<float32>> full(segments);
+  report_time("full", min_time([&] {
+                for (size_t i = 0; i < segments; ++i)
+                  full[i] = geodesic_distances(method, surface, prefix(i));
+              }, 1));
+  vector<vector<float32>> incremental(segments);
+  report_time("incremental", min_time([&] {
+                heat_field field{};
+                for (size_t i = 0; i < segments; ++i) {
+                  add_heat_sources(method, field, prefix(i));
+                  incremental[i] = geodesic_distances(method, surface, field);
+                }
+              }, 1));
+  // Changing only the tolerance of the viewer adds no new sources.
+  heat_field field{};
+  add_heat_sources(method, field, line);
+  report_time("without new sources", min_time([&] {
+                for (size_t i = 0; i < segments; ++i) {
+                  add_heat_sources(method, field, line);
+                  geodesic_distances(method, surface, field);
+                }
+              }, 1));
+
+  float64 difference = 0;
+  float64 max_distance = 0;
+  for (size_t i = 0; i < segments; ++i) {
+    for (size_t j = 0; j < full[i].size(); ++j) {
+      const auto d = abs(float64(full[i][j]) - incremental[i][j]);
+      difference = std::max(difference, d);
+      max_distance = std::max(max_distance, float64(full[i][j]));
+    }
+  }
+  cout << setprecision(6) << "(incremental distances differ by "
+       << difference / max_distance << " relative to the largest one)\n";
+}
+
+// Distances to many independent sets of a few random sources
+// either by one solve per set or by the blocked solves of all sets
+//
+void batched_heat(const filesystem::path& path) {
+  using vertex_id = polyhedral_surface::vertex_id;
+  const auto surface = welded(polyhedral_surface_from(path));
+  const auto method = heat_method_from(surface, heat_time_step(surface));
+  const auto n = surface.vertices.size();
+  constexpr size_t count = 64;
+  mt19937 rng{12345};
+  uniform_int_distribution<vertex_id> vertex(0, n - 1);
+  uniform_int_distribution<size_t> size(1, 4);
+  vector<vector<vertex_id>> source_sets(count);
+  for (auto& sources : source_sets) {
+    sources.resize(size(rng));
+    for (auto& s : sources) s = vertex(rng);
+  }
+  cout << "Batched heat on " << path << " (" << n << " vertices, " << count
+       << " source sets, " << thread_count() << " threads)\n";
+  const auto report_time = [&](czstring name, float64 time) {
+    cout << setw(30) << name << " = " << setw(10) << setprecision(3) << fixed
+         << time / count << " s/set\n";
+  };
+
+  vector<float32> single(n * count);
+  report_time("single", min_time([&] {
+                for (size_t i = 0; i < count; ++i)
+                  ranges::copy(
+                      geodesic_distances(method, surface, source_sets[i]),
+                      single.begin() + i * n);
+              }, 1));
+  vector<float32> batched{};
+  report_time("batched", min_time([&] {
+                batched = geodesic_distance_matrix(method, surface,
+                                                   source_sets);
+              }, 1));
+
+  float64 difference = 0;
+  for (size_t i = 0; i < single.size(); ++i)
+    difference =
+        std::max(difference, abs(float64(single[i]) - batched[i]));
+  cout << setprecision(6) << "(batched distances differ by "
+       << difference / ranges::max(single) << " relative to the largest one)\n";
+}
+
+// Distances up to several radii around a short line
+// by the local heat method compared to the whole surface.
+// The local method analyzes and factorizes its band for every solve.
+//
+void local_heat(const filesystem::path& path) {
+  const auto surface = welded(polyhedral_surface_from(path));
+  const auto n = surface.vertices.size();
+  cout << "Local heat on " << path << " (" << n << " vertices)\n";
+  const auto report_time = [](czstring name, float64 time) {
+    cout << setw(30) << name << " = " << setw(10) << setprecision(3) << fixed
+         << time << " s\n";
+  };
+  const auto time_step = heat_time_step(surface);
+  const auto line = breadth_first_line(surface);
+  const auto sources = span{line}.first(std::min(line.size(), size_t{8}));
+
+  heat_method method{};
+  report_time("full precomputation", min_time([&] {
+                method = heat_method_from(surface, time_step);
+              }, 1));
+  vector<float32> full{};
+  report_time("full solve", min_time([&] {
+                full = geodesic_distances(method, surface, sources);
+              }, 1));
+  vertex_adjacency adjacency{};
+  report_time("vertex adjacency", min_time([&] {
+                adjacency = vertex_adjacency_from(surface);
+              }, 1));
+  vertex_faces incidence{};
+  report_time("vertex faces", min_time([&] {
+                incidence = vertex_faces_from(surface);
+              }, 1));
+
+  for (auto fraction : {0.01, 0.03, 0.1, 0.3}) {
+    const auto radius = fraction * ranges::max(full);
+    cout << setprecision(2) << "radius = " << fraction
+         << " of the largest distance\n";
+    optional<local_distances<float32>> local{};
+    report_time("local solve", min_time([&] {
+                  local = local_geodesic_distances<float32>(
+                      surface, adjacency, incidence, time_step, sources,
+                      radius);
+                }, 1));
+    if (!local) {
+      cout << "(band too large, falls back to the whole surface)\n";
+      continue;
+    }
+    float64 difference = 0;
+    for (size_t i = 0; i < local->vertices.size(); ++i)
+      difference = std::max(difference, abs(float64(local->distances[i]) -
+                                            full[local->vertices[i]]));
+    cout << setprecision(6) << "(" << local->vertices.size()
+         << " vertices in radius"
+         << " differ by " << difference / radius << " relative to it)\n";
+  }
+}
+
+// Software rendering of the surface with a curve around it
+// for several tile sizes.
+//
+void software_rendering(const filesystem::path& path) {
+  const auto surface = welded(polyhedral_surface_from(path));
+  cout << "Rendering of " << path << " (" << surface.faces.size()
+       << " faces, " << thread_count() << " threads)\n";
+  const auto tree = bvh_from(surface);
+  const auto box = aabb_from(surface);
+  const int resolution = 1024;
+  const auto cam = fitting_camera(box, resolution, resolution);
+
+  vector<vec3> circle(256);
+  for (size_t i = 0; i < circle.size(); ++i) {
+    const auto phi = 2.0f * pi * i / (circle.size() - 1);
+    circle[i] = box.origin() + box.radius() * vec3{cos(phi), sin(phi), 0.0f};
+  }
+  const render_curve curves[] = {{.points = circle}};
+
+  rgb_image image{};
+  for (size_t tile_size : {8, 16, 32, 64}) {
+    const auto time = min_time([&] {
+      image = render(cam, tree, surface.vertices, surface.faces,
+                     {.curves = curves, .tile_size = tile_size});
+    }, 3);
+    const auto name = "tiles of size " + to_string(tile_size);
+    report_rays(name.c_str(), time, size_t(resolution) * resolution);
+  }
+}
+
+// Nearest-vertex queries by the kd-tree and closest-point queries
+// by the BVH compared to their brute-force versions.
+//
+void nearest_queries(const filesystem::path& path) {
+  const auto surface = welded(polyhedral_surface_from(path));
+  cout << "Nearest queries on " << path << " (" << surface.vertices.size()
+       << " vertices, " << surface.faces.size() << " faces, "
+       << thread_count() << " threads)\n";
+
+  kd_tree vertex_tree{};
+  const auto kd_time =
+      min_time([&] { vertex_tree = kd_tree_from(surface.vertices); }, 3);
+  cout << setw(30) << "kd-tree build" << " = " << setw(10) << setprecision(3)
+       << fixed << kd_time << " s\n";
+  const auto tree = bvh_from(surface);
+
+  // Points scattered around the surface
+  const size_t count = 1 << 18;
+  const auto box = aabb_from(surface);
+  mt19937 rng{12345};
+  uniform_real_distribution<float32> uniform{-0.25f, 1.25f};
+  vector<vec3> points(count);
+  for (auto& p : points)
+    p = box._min + vec3{uniform(rng), uniform(rng), uniform(rng)} *
+                       (box._max - box._min);
+
+  const auto brute_force_count = std::clamp(
+      size_t(2e8 / std::max(surface.faces.size(), size_t{1})), size_t{16},
+      count);
+
+  // Nearest vertices
+  //
+  vector<vertex_neighbor> reference(brute_force_count);
+  report_queries("brute-force vertex", min_time([&] {
+                   for (size_t i = 0; i < brute_force_count; ++i) {
+                     vertex_neighbor result{};
+                     for (size_t j = 0; j < surface.vertices.size(); ++j) {
+                       const auto d =
+                           distance2(points[i], surface.vertices[j].position);
+                       if (d < result.squared_distance) result = {uint32(j), d};
+                     }
+                     reference[i] = result;
+                   }
+                 }, 1),
+                 brute_force_count);
+  vector<vertex_neighbor> neighbors(count);
+  report_queries("kd-tree vertex", min_time([&] {
+                   for (size_t i = 0; i < count; ++i)
+                     neighbors[i] = nearest(points[i], vertex_tree);
+                 }),
+                 count);
+  report_queries("batched kd-tree vertex", min_time([&] {
+                   nearest(vertex_tree, points, neighbors);
+                 }),
+                 count);
+  size_t k_count = 0;
+  report_queries("kd-tree 8 vertices", min_time([&] {
+                   for (size_t i = 0; i < count; ++i)
+                     k_count += k_nearest(points[i], vertex_tree, 8).size();
+                 }),
+                 count);
+  size_t mismatches = 0;
+  for (size_t i = 0; i < brute_force_count; ++i) {
+    const auto k = k_nearest(points[i], vertex_tree, 8);
+    mismatches += (reference[i].id != neighbors[i].id) ||
+                  (reference[i].squared_distance !=
+                   neighbors[i].squared_distance) ||
+                  (k.empty() || (k[0].id != reference[i].id));
+  }
+  cout << "(" << mismatches << " mismatches in " << brute_force_count
+       << " compared points)\n";
+
+  // Closest surface points
+  //
+  vector<surface_point> closest(brute_force_count);
+  report_queries("brute-force surface", min_time([&] {
+                   for (size_t i = 0; i < brute_force_count; ++i)
+                     closest[i] = closest_point(points[i], surface);
+                 }, 1),
+                 brute_force_count);
+  vector<surface_point> results(count);
+  report_queries("BVH surface", min_time([&] {
+                   for (size_t i = 0; i < count; ++i)
+                     results[i] = closest_point(points[i], tree);
+                 }),
+                 count);
+  report_queries("batched BVH surface", min_time([&] {
+                   closest_points(tree, points, results);
+                 }),
+                 count);
+  mismatches = 0;
+  for (size_t i = 0; i < brute_force_count; ++i) {
+    const auto& x = closest[i];
+    const auto& y = results[i];
+    mismatches += (x.f != y.f) || (x.u != y.u) || (x.v != y.v) ||
+                  (x.squared_distance != y.squared_distance);
+  }
+  cout << "(" << mismatches << " mismatches in " << brute_force_count
+       << " compared points)\n";
+}
+
+struct benchmark {
+  czstring name;
+  czstring usage;
+  void (*run)(const filesystem::path&);
+};
+
+constexpr benchmark benchmarks[] = {
+    {"stl", "<binary STL file>", stl_load},
+    {"obj", "<OBJ file>", obj_load},
+    {"ply", "<binary PLY file>", ply_load_save},
+    {"bvh", "<surface mesh file>", bvh_intersection},
+    {"simd", "<surface mesh file>", simd_intersection},
+    {"rays", "<surface mesh file>", batched_intersection},
+    {"occlusion", "<surface mesh file>", occlusion},
+    {"refit", "<surface mesh file>", bvh_refit},
+    {"compressed", "<surface mesh file>", compressed_intersection},
+    {"statistics", "<surface mesh file>", ray_tracing_statistics},
+    {"heat", "<surface mesh file>", heat_precomputation},
+    {"solvers", "<surface mesh file>", heat_solvers},
+    {"incremental", "<surface mesh file>", incremental_heat},
+    {"batched", "<surface mesh file>", batched_heat},
+    {"local", "<surface mesh file>", local_heat},
+    {"render", "<surface mesh file>", software_rendering},
+    {"nearest", "<surface mesh file>", nearest_queries},
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc == 3) {
+    for (const auto& b : benchmarks) {
+      if (b.name != string_view{argv[1]}) continue;
+      b.run(argv[2]);
+      return 0;
+    }
+  }
+
+  cout << "Usage:\n";
+  for (const auto& b : benchmarks)
+    cout << argv[0] << ' ' << b.name << ' ' << b.usage << '\n';
+}
@@ -0,0 +1,861 @@
+#include <hyperreflex/bvh.hpp>
+//
+#include <hyperreflex/parallel.hpp>
+
+namespace hyperreflex {
+
+namespace {
+
+using size_type = bvh::size_type;
+
+constexpr auto empty_box() noexcept {
+  aabb3 result{};
+  result._min = vec3{infinity};
+  result._max = vec3{-infinity};
+  return result;
+}
+
+constexpr auto area(const aabb3& box) noexcept -> float32 {
+  const auto d = box._max - box._min;
+  if ((d.x < 0) || (d.y < 0) || (d.z < 0)) return 0;
+  return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+// Every face is represented by its bounding box and centroid during the build.
+//
+struct reference {
+  aabb3 box;
+  vec3 centroid;
+  polyhedral_surface::face_id f;
+};
+
+struct bounds {
+  void insert(const reference& r) noexcept {
+    box = aabb(box, r.box);
+    centroids = aabb(centroids, r.centroid);
+  }
+  void insert(const bounds& b) noexcept {
+    box = aabb(box, b.box);
+    centroids = aabb(centroids, b.centroids);
+  }
+
+  aabb3 box = empty_box();
+  aabb3 centroids = empty_box();
+};
+
+class bvh_builder {
+ public:
+  static constexpr size_t bin_count = 16;
+  // Relative costs of traversing a node and intersecting a triangle block
+  static constexpr float32 traversal_cost = 1.0f;
+  static constexpr float32 intersection_cost = 1.0f;
+  // Ranges of at least this size are processed in parallel.
+  static constexpr size_t parallel_threshold = size_t{1} << 14;
+
+  bvh_builder(vector<reference>& refs,
+              bvh::node* nodes,
+              size_t width,
+              size_t leaf_size) noexcept
+      : refs{refs}, nodes{nodes}, width{width}, leaf_size{leaf_size} {
+    // Spawn new tasks only for the top levels of the tree.
+    while ((size_t{1} << task_depth) < 4 * thread_count()) ++task_depth;
+  }
+
+  auto node_count() const noexcept -> size_type { return count; }
+
+  // The depth of the root is only needed for subtrees of other trees.
+  //
+  void build(size_type depth = 0) {
+    count = 1;
+    build(0, 0, refs.size(), bounds_of(0, refs.size()), depth);
+  }
+
+ private:
+  auto bounds_of(size_t first, size_t last) const -> bounds {
+    if (last - first < parallel_threshold) {
+      bounds result{};
+      for (auto i = first; i < last; ++i) result.insert(refs[i]);
+      return result;
+    }
+    vector<bounds> partial(thread_count());
+    mutex partial_mutex{};
+    size_t block = 0;
+    parallel_for_blocks(first, last, [&](size_t block_first, size_t block_last) {
+      bounds result{};
+      for (auto i = block_first; i < block_last; ++i) result.insert(refs[i]);
+      scoped_lock lock{partial_mutex};
+      partial[block++] = result;
+    });
+    bounds result{};
+    for (const auto& b : partial) result.insert(b);
+    return result;
+  }
+
+  struct split {
+    float32 cost = infinity;
+    int axis = -1;
+    size_t bin = 0;
+  };
+
+  struct bin {
+    aabb3 box = empty_box();
+    size_t count = 0;
+  };
+  using bins = array<array<bin, bin_count>, 3>;
+
+  static auto bin_index(float32 c, float32 low, float32 scale) noexcept {
+    return std::min(size_t(std::max((c - low) * scale, 0.0f)), bin_count - 1);
+  }
+
+  auto binned(size_t first, size_t last, const aabb3& centroids) const
+      -> bins {
+    const auto extent = centroids._max - centroids._min;
+    const auto scale = float32(bin_count) / extent;
+    const auto fill = [&](size_t block_first, size_t block_last, bins& result) {
+      for (auto i = block_first; i < block_last; ++i) {
+        const auto& r = refs[i];
+        for (int axis = 0; axis < 3; ++axis) {
+          if (!(extent[axis] > 0)) continue;
+          auto& b = result[axis][bin_index(
+              r.centroid[axis], centroids._min[axis], scale[axis])];
+          b.box = aabb(b.box, r.box);
+          ++b.count;
+        }
+      }
+    };
+
+    bins result{};
+    if (last - first < parallel_threshold) {
+      fill(first, last, result);
+      return result;
+    }
+    mutex result_mutex{};
+    parallel_for_blocks(first, last, [&](size_t block_first, size_t block_last) {
+      bins partial{};
+      fill(block_first, block_last, partial);
+      scoped_lock lock{result_mutex};
+      for (int axis = 0; axis < 3; ++axis)
+        for (size_t i = 0; i < bin_count; ++i) {
+          auto& b = result[axis][i];
+          b.box = aabb(b.box, partial[axis][i].box);
+          b.count += partial[axis][i].count;
+        }
+    });
+    return result;
+  }
+
+  // The kernel tests whole blocks of triangles.
+  // So, the costs of a leaf depend on its number of blocks.
+  //
+  auto blocks(size_t n) const noexcept -> float32 {
+    return (n + width - 1) / width;
+  }
+
+  auto best_split(const bins& bins, float32 parent_area) const noexcept
+      -> split {
+    split result{};
+    for (int axis = 0; axis < 3; ++axis) {
+      // Sweep from the right to get the costs of all right partitions.
+      array<float32, bin_count> right_costs{};
+      auto box = empty_box();
+      size_t count = 0;
+      // Small nodes leave most bins empty. These do not change the sweep.
+      float32 right_cost = 0;
+      for (size_t i = bin_count - 1; i > 0; --i) {
+        if (bins[axis][i].count > 0) {
+          box = aabb(box, bins[axis][i].box);
+          count += bins[axis][i].count;
+          right_cost = area(box) * blocks(count);
+        }
+        right_costs[i] = right_cost;
+      }
+      // Sweep from the left and evaluate every split between two bins.
+      box = empty_box();
+      count = 0;
+      for (size_t i = 0; i < bin_count - 1; ++i) {
+        if (bins[axis][i].count == 0) continue;
+        box = aabb(box, bins[axis][i].box);
+        count += bins[axis][i].count;
+        const auto cost =
+            traversal_cost + intersection_cost *
+                                 (area(box) * blocks(count) +
+                                  right_costs[i + 1]) /
+                                 parent_area;
+        if (cost < result.cost) result = {cost, axis, i + 1};
+      }
+    }
+    return result;
+  }
+
+  // Leaves store their range of references
+  // which is turned into a range of blocks after the build.
+  //
+  void make_leaf(size_type index,
+                 size_t first,
+                 size_t last,
+                 const aabb3& box) noexcept {
+    nodes[index] = {.box = box,
+                    .offset = size_type(first),
+                    .count = size_type(last - first)};
+  }
+
+  void build(size_type index,
+             size_t first,
+             size_t last,
+             const bounds& b,
+             size_type depth) {
+    const auto n = last - first;
+    if (n == 1) {
+      make_leaf(index, first, last, b.box);
+      return;
+    }
+
+    size_t mid = first + n / 2;
+    const auto extent = b.centroids._max - b.centroids._min;
+    const bool splittable =
+        (extent.x > 0) || (extent.y > 0) || (extent.z > 0);
+    split s{};
+    if (splittable && (depth < bvh::max_sah_depth))
+      s = best_split(binned(first, last, b.centroids), area(b.box));
+    if (s.axis >= 0) {
+      const auto leaf_cost = intersection_cost * blocks(n);
+      if ((n <= leaf_size) && (leaf_cost <= s.cost)) {
+        make_leaf(index, first, last, b.box);
+        return;
+      }
+      const auto axis = s.axis;
+      const auto low = b.centroids._min[axis];
+      const auto scale = float32(bin_count) / extent[axis];
+      mid = partition(refs.begin() + first, refs.begin() + last,
+                      [&](const reference& r) {
+                        return bin_index(r.centroid[axis], low, scale) < s.bin;
+                      }) -
+            refs.begin();
+      // Rounding may put all centroids into one partition.
+      if ((mid == first) || (mid == last)) mid = first + n / 2;
+    } else {
+      // All centroids are equal, the faces are degenerate,
+      // or the tree gets too deep. Then, the range is split
+      // at the median along the longest axis.
+      if (n <= leaf_size) {
+        make_leaf(index, first, last, b.box);
+        return;
+      }
+      const int axis = (extent.x >= extent.y)
+                           ? ((extent.x >= extent.z) ? 0 : 2)
+                           : ((extent.y >= extent.z) ? 1 : 2);
+      nth_element(refs.begin() + first, refs.begin() + mid,
+                  refs.begin() + last,
+                  [axis](const reference& x, const reference& y) {
+                    return x.centroid[axis] < y.centroid[axis];
+                  });
+    }
+
+    const auto children = count.fetch_add(2);
+    nodes[index] = {.box = b.box, .offset = children, .count = 0};
+
+    const auto left = [&] {
+      build(children, first, mid, bounds_of(first, mid), depth + 1);
+    };
+    const auto right = [&] {
+      build(children + 1, mid, last, bounds_of(mid, last), depth + 1);
+    };
+    if ((n >= parallel_threshold) && (depth < task_depth)) {
+      // Both subtrees share the threads of their parent
+      // for computing bounds and bins in parallel.
+      // Otherwise, every task would use all threads on its own.
+      //
+      const auto threads = thread_count() / 2;
+      auto task = async(launch::async, [&] {
+        thread_limit_guard limit{threads};
+        left();
+      });
+      thread_limit_guard limit{threads};
+      right();
+      task.get();
+    } else {
+      left();
+      right();
+    }
+  }
+
+  vector<reference>& refs;
+  bvh::node* nodes;
+  size_t width;
+  size_t leaf_size;
+  atomic<size_type> count = 0;
+  size_type task_depth = 0;
+};
+
+// Robust ray-box test with the entry distance as result.
+// Missed boxes get an infinite distance.
+// Rays parallel to a slab are handled separately to not produce NaNs.
+// To not miss any hit that the triangle test would find,
+// the distances are enlarged by a small relative tolerance.
+//
+constexpr float32 slack = 1.0f + 1e-5f;
+
+inline auto entry(const aabb3& box,
+                  const ray& r,
+                  const vec3& inverse_direction,
+                  float32 tmax) noexcept -> float32 {
+  float32 enter = 0.0f;
+  float32 exit = tmax;
+  for (int k = 0; k < 3; ++k) {
+    if (r.direction[k] == 0.0f) {
+      if ((r.origin[k] < box._min[k]) || (r.origin[k] > box._max[k]))
+        return infinity;
+      continue;
+    }
+    auto a = (box._min[k] - r.origin[k]) * inverse_direction[k];
+    auto b = (box._max[k] - r.origin[k]) * inverse_direction[k];
+    if (a > b) swap(a, b);
+    enter = std::max(enter, a);
+    exit = std::min(exit, b * slack);
+  }
+  return (enter <= exit) ? enter : infinity;
+}
+
+// Insert two zero bits between all of the lowest bits.
+//
+constexpr auto spread_bits(uint32 x) noexcept {
+  x &= 0x3ff;
+  x = (x | (x << 16)) & 0x30000ff;
+  x = (x | (x << 8)) & 0x300f00f;
+  x = (x | (x << 4)) & 0x30c30c3;
+  x = (x | (x << 2)) & 0x9249249;
+  return x;
+}
+
+// Morton code of a point with the given bits per coordinate
+// whose coordinates have already been mapped to '[0, 1]'.
+//
+constexpr auto morton_code(const vec3& p, uint32 bits) noexcept -> uint32 {
+  const auto quantized = [bits](float32 x) {
+    return uint32(std::clamp(x, 0.0f, 1.0f) * ((1u << bits) - 1));
+  };
+  return (spread_bits(quantized(p.x)) << 2) |
+         (spread_bits(quantized(p.y)) << 1) | spread_bits(quantized(p.z));
+}
+
+// Rays are bucketed by the octant of their direction,
+// the coarse direction inside the octant, and their coarse origin.
+// Neighbors in this order mostly visit the same nodes.
+//
+constexpr uint32 coherence_bits = 3 + 3 * 3 + 3 * 2;
+
+auto coherence_keys(span<const ray> rays) -> vector<uint32> {
+  auto box = empty_box();
+  for (const auto& r : rays) box = aabb(box, r.origin);
+  const auto size = box._max - box._min;
+  const auto scale = vec3{size.x > 0 ? 1 / size.x : 0,
+                          size.y > 0 ? 1 / size.y : 0,
+                          size.z > 0 ? 1 / size.z : 0};
+
+  vector<uint32> keys(rays.size());
+  parallel_for(0, rays.size(), [&](size_t i) {
+    const auto& d = rays[i].direction;
+    const auto octant =
+        (uint32(d.x < 0) << 2) | (uint32(d.y < 0) << 1) | uint32(d.z < 0);
+    const auto direction = morton_code(abs(d), 3);
+    const auto origin = morton_code((rays[i].origin - box._min) * scale, 2);
+    keys[i] = (octant << 15) | (direction << 6) | origin;
+  });
+  return keys;
+}
+
+// Compute the SAH costs of a subtree relative to the area of its nodes.
+// Only ratios of these costs are used and no traversal costs are needed.
+//
+auto sah_cost(const bvh& tree, size_type index, float32* costs) -> float32 {
+  const auto& node = tree.nodes[index];
+  auto cost = bvh_builder::intersection_cost * node.count;
+  if (!node.leaf()) {
+    const auto& left = tree.nodes[node.offset];
+    const auto& right = tree.nodes[node.offset + 1];
+    const auto left_cost = sah_cost(tree, node.offset, costs);
+    const auto right_cost = sah_cost(tree, node.offset + 1, costs);
+    cost = bvh_builder::traversal_cost +
+           (area(left.box) * left_cost + area(right.box) * right_cost) /
+               std::max(area(node.box), numeric_limits<float32>::min());
+  }
+  costs[index] = cost;
+  return cost;
+}
+
+void update_costs(bvh& tree, size_type index) {
+  sah_cost(tree, index, tree.costs.data());
+}
+
+// Recompute the triangles and boxes of a BVH bottom-up
+// for new vertex positions of the same faces.
+// The subtrees of the top levels are processed by concurrent tasks.
+//
+class bvh_refitter {
+ public:
+  bvh_refitter(bvh& tree,
+               span<const polyhedral_surface::vertex> vertices,
+               span<const polyhedral_surface::face> faces) noexcept
+      : tree{tree}, vertices{vertices}, faces{faces} {
+    while ((size_t{1} << task_depth) < 4 * thread_count()) ++task_depth;
+  }
+
+  void refit() {
+    if (!tree.empty()) refit(0, 0);
+  }
+
+ private:
+  void refit(size_type index, size_type depth) {
+    auto& node = tree.nodes[index];
+
+    if (node.leaf()) {
+      auto& blocks = tree.triangles;
+      auto box = empty_box();
+      for (auto b = node.offset; b < node.offset + node.count; ++b) {
+        for (size_t lane = 0; lane < blocks.width; ++lane) {
+          const auto f = blocks.faces[b * blocks.width + lane];
+          if (f == polyhedral_surface::invalid) continue;
+          const auto& face = faces[f];
+          const triangle t{vertices[face[0]].position,
+                           vertices[face[1]].position,
+                           vertices[face[2]].position};
+          blocks.set(b, lane, t, f);
+          box = aabb(aabb(aabb(box, t[0]), t[1]), t[2]);
+        }
+      }
+      node.box = box;
+      return;
+    }
+
+    const auto left = [&] { refit(node.offset, depth + 1); };
+    const auto right = [&] { refit(node.offset + 1, depth + 1); };
+    if (depth < task_depth) {
+      auto task = async(launch::async, left);
+      right();
+      task.get();
+    } else {
+      left();
+      right();
+    }
+    node.box = aabb(tree.nodes[node.offset].box, tree.nodes[node.offset + 1].box);
+  }
+
+  bvh& tree;
+  span<const polyhedral_surface::vertex> vertices;
+  span<const polyhedral_surface::face> faces;
+  size_type task_depth = 0;
+};
+
+// Rebuild the inner nodes of a subtree over its unchanged leaves.
+// A binary tree over the same leaves has the same number of inner nodes.
+// So, the new subtree reuses the nodes of the old one
+// and neither the triangle blocks nor the rest of the tree change.
+//
+void rebuild(bvh& tree, size_type root, size_type depth) {
+  vector<size_type> pairs{};
+  vector<bvh::node> leaves{};
+  vector<size_type> stack{root};
+  while (!stack.empty()) {
+    const auto& node = tree.nodes[stack.back()];
+    stack.pop_back();
+    if (node.leaf()) {
+      leaves.push_back(node);
+      continue;
+    }
+    pairs.push_back(node.offset);
+    stack.push_back(node.offset);
+    stack.push_back(node.offset + 1);
+  }
+
+  vector<reference> refs(leaves.size());
+  for (size_t i = 0; i < leaves.size(); ++i) {
+    const auto& box = leaves[i].box;
+    refs[i] = {.box = box,
+               .centroid = (box._min + box._max) / 2.0f,
+               .f = polyhedral_surface::face_id(i)};
+  }
+  // Every leaf is a single primitive of the builder.
+  auto nodes = make_unique_for_overwrite<bvh::node[]>(2 * refs.size() - 1);
+  bvh_builder builder{refs, nodes.get(), 1, 1};
+  builder.build(depth);
+
+  // The builder allocates children in pairs starting at index one.
+  // So, every pair of new nodes is mapped to one of the old pairs.
+  vector<pair<size_type, size_type>> assignments{{0, root}};
+  while (!assignments.empty()) {
+    const auto [from, to] = assignments.back();
+    assignments.pop_back();
+    const auto& node = nodes[from];
+    if (node.leaf()) {
+      tree.nodes[to] = leaves[refs[node.offset].f];
+      continue;
+    }
+    const auto children = pairs[(node.offset - 1) / 2];
+    tree.nodes[to] = {.box = node.box, .offset = children, .count = 0};
+    assignments.push_back({node.offset, children});
+    assignments.push_back({node.offset + 1, children + 1});
+  }
+}
+
+// Rebuild all maximal subtrees whose relative SAH cost
+// has grown by more than the given factor since their last build.
+//
+auto rebuild_degraded(bvh& tree,
+                      span<const float32> costs,
+                      float32 factor,
+                      size_type index,
+                      size_type depth) -> size_t {
+  const auto& node = tree.nodes[index];
+  if (node.leaf()) return 0;
+  if (costs[index] > factor * tree.costs[index]) {
+    rebuild(tree, index, depth);
+    update_costs(tree, index);
+    return 1;
+  }
+  const auto children = node.offset;
+  return rebuild_degraded(tree, costs, factor, children, depth + 1) +
+         rebuild_degraded(tree, costs, factor, children + 1, depth + 1);
+}
+
+}  // namespace
+
+auto bvh_topology_from(const polyhedral_surface& surface,
+                       size_t width,
+                       size_t leaf_size) -> bvh_topology {
+  bvh_topology result{};
+  const auto m = surface.faces.size();
+  if (m == 0) return result;
+
+  const auto& v = surface.vertices;
+  vector<reference> refs(m);
+  parallel_for(0, m, [&](size_t i) {
+    const auto& f = surface.faces[i];
+    const auto& p = v[f[0]].position;
+    const auto& q = v[f[1]].position;
+    const auto& r = v[f[2]].position;
+    refs[i] = {.box = aabb(aabb(p, q), r),
+               .centroid = (p + q + r) / 3.0f,
+               .f = polyhedral_surface::face_id(i)};
+  });
+
+  // A binary tree with 'm' leaves has '2m - 1' nodes.
+  // The memory is not initialized and only touched when nodes are created.
+  auto nodes = make_unique_for_overwrite<bvh::node[]>(2 * m - 1);
+  bvh_builder builder{refs, nodes.get(), width, leaf_size};
+  builder.build();
+  result.nodes.assign(nodes.get(), nodes.get() + builder.node_count());
+
+  result.faces.resize(m);
+  parallel_for(0, m, [&](size_t i) { result.faces[i] = refs[i].f; });
+  return result;
+}
+
+auto bvh_from(const polyhedral_surface& surface, size_t width) -> bvh {
+  bvh result{};
+  if (surface.faces.empty()) return result;
+
+  auto topology = bvh_topology_from(
+      surface, width, std::max(size_t{bvh::max_leaf_size}, width));
+  result.nodes = std::move(topology.nodes);
+  const auto& faces = topology.faces;
+
+  // Every leaf gets its own blocks of triangles.
+  // The blocks are ordered like the faces of the leaves.
+  //
+  vector<size_type> leaves{};
+  for (size_type i = 0; i < result.nodes.size(); ++i)
+    if (result.nodes[i].leaf()) leaves.push_back(i);
+  ranges::sort(leaves, less{}, [&](size_type i) {
+    return result.nodes[i].offset;
+  });
+  vector<size_t> block_offsets(leaves.size() + 1);
+  for (size_t i = 0; i < leaves.size(); ++i)
+    block_offsets[i + 1] =
+        block_offsets[i] + (result.nodes[leaves[i]].count + width - 1) / width;
+
+  const auto& v = surface.vertices;
+  result.triangles = triangle_blocks(width, block_offsets.back());
+  parallel_for(0, leaves.size(), [&](size_t i) {
+    auto& node = result.nodes[leaves[i]];
+    for (size_t j = 0; j < node.count; ++j) {
+      const auto f = faces[node.offset + j];
+      const auto& face = surface.faces[f];
+      result.triangles.set(
+          block_offsets[i] + j / width, j % width,
+          {v[face[0]].position, v[face[1]].position, v[face[2]].position}, f);
+    }
+    node.offset = block_offsets[i];
+    node.count = block_offsets[i + 1] - block_offsets[i];
+  });
+
+  result.costs.resize(result.nodes.size());
+  update_costs(result, 0);
+  return result;
+}
+
+auto memory_usage(const bvh& tree) noexcept -> size_t {
+  return tree.nodes.size() * sizeof(bvh::node) +
+         tree.costs.size() * sizeof(float32) +
+         tree.triangles.data.size() * sizeof(float32) +
+         tree.triangles.faces.size() * sizeof(polyhedral_surface::face_id);
+}
+
+auto refit(bvh& tree,
+           span<const polyhedral_surface::vertex> vertices,
+           span<const polyhedral_surface::face> faces,
+           float32 rebuild_factor) -> size_t {
+  if (tree.empty()) return 0;
+  bvh_refitter{tree, vertices, faces}.refit();
+  if (rebuild_factor == infinity) return 0;
+
+  vector<float32> costs(tree.nodes.size());
+  sah_cost(tree, 0, costs.data());
+  return rebuild_degraded(tree, costs, rebuild_factor, 0, 0);
+}
+
+auto intersection(const ray& r, const bvh& tree) noexcept
+    -> ray_polyhedral_surface_intersection {
+  ray_query_statistics statistics{};
+  ray_polyhedral_surface_intersection result{};
+  result.t = infinity;
+  if (tree.empty()) return result;
+
+  const auto inverse_direction = 1.0f / r.direction;
+  const auto& nodes = tree.nodes;
+
+  // Every stack entry stores the entry distance of its node.
+  // So, nodes behind a hit that has been found later can be skipped.
+  struct entry_type {
+    size_type node;
+    float32 t;
+  };
+  array<entry_type, bvh::stack_size> stack;
+  size_type top = 0;
+  const auto t_root = entry(nodes[0].box, r, inverse_direction, infinity);
+  if (t_root != infinity) stack[top++] = {0, t_root};
+
+  while (top > 0) {
+    const auto [index, t] = stack[--top];
+    const auto tmax = result.t * slack;
+    if (t > tmax) continue;
+    const auto& node = nodes[index];
+    statistics.visit_node();
+
+    if (node.leaf()) {
+      statistics.test_triangles(node.count * tree.triangles.width);
+      intersect_blocks(r, tree.triangles, node.offset,
+                       node.offset + node.count, result);
+      continue;
+    }
+
+    // Visit the nearer child first by pushing it last.
+    auto near = node.offset;
+    auto far = node.offset + 1;
+    auto t_near = entry(nodes[near].box, r, inverse_direction, tmax);
+    auto t_far = entry(nodes[far].box, r, inverse_direction, tmax);
+    if (t_far < t_near) {
+      swap(near, far);
+      swap(t_near, t_far);
+    }
+    if (t_far != infinity) stack[top++] = {far, t_far};
+    if (t_near != infinity) stack[top++] = {near, t_near};
+  }
+  statistics.hit(result);
+  return result;
+}
+
+auto occluded(const ray& r, const bvh& tree, float32 tmax) noexcept -> bool {
+  ray_query_statistics statistics{};
+  if (tree.empty()) return false;
+
+  const auto inverse_direction = 1.0f / r.direction;
+  const auto& nodes = tree.nodes;
+  const auto box_tmax = tmax * slack;
+
+  // The order of the children does not change the result.
+  // So, it is chosen to find some hit as early as possible.
+  // Leaves are tested first as they might end the traversal immediately.
+  // Otherwise, the larger child is more likely to contain an occluder.
+  array<size_type, bvh::stack_size> stack;
+  size_type top = 0;
+  if (entry(nodes[0].box, r, inverse_direction, box_tmax) != infinity)
+    stack[top++] = 0;
+
+  while (top > 0) {
+    const auto& node = nodes[stack[--top]];
+    statistics.visit_node();
+
+    if (node.leaf()) {
+      statistics.test_triangles(node.count * tree.triangles.width);
+      if (occluded(r, tree.triangles, node.offset, node.offset + node.count,
+                   tmax)) {
+        statistics.hit(true);
+        return true;
+      }
+      continue;
+    }
+
+    auto first = node.offset;
+    auto second = node.offset + 1;
+    const auto hit_first =
+        entry(nodes[first].box, r, inverse_direction, box_tmax) != infinity;
+    const auto hit_second =
+        entry(nodes[second].box, r, inverse_direction, box_tmax) != infinity;
+    if (hit_first && hit_second) {
+      const auto priority = [&](size_type i) {
+        return pair{nodes[i].leaf(), area(nodes[i].box)};
+      };
+      if (priority(first) < priority(second)) swap(first, second);
+      stack[top++] = second;
+      stack[top++] = first;
+    } else if (hit_first) {
+      stack[top++] = first;
+    } else if (hit_second) {
+      stack[top++] = second;
+    }
+  }
+  return false;
+}
+
+// Answer all queries of the batch in a coherent order on all threads.
+// The query gets the ray and its index in the batch.
+//
+template <typename type>
+void coherent_queries(span<const ray> rays, span<type> results, auto&& query) {
+  assert(rays.size() == results.size());
+
+  // Small batches are not worth sorting and threading.
+  constexpr size_t packet_size = 256;
+  if (rays.size() <= packet_size) {
+    for (size_t i = 0; i < rays.size(); ++i) results[i] = query(rays[i], i);
+    return;
+  }
+
+  // A stable counting sort keeps the given order inside every bucket.
+  // So, rays that are already coherent stay coherent.
+  const auto keys = coherence_keys(rays);
+  vector<uint32> offsets((size_t{1} << coherence_bits) + 1);
+  for (auto key : keys) ++offsets[key + 1];
+  inclusive_scan(begin(offsets), end(offsets), begin(offsets));
+  vector<uint32> order(rays.size());
+  for (size_t i = 0; i < rays.size(); ++i) order[offsets[keys[i]]++] = i;
+
+  // Traversing the rays in place would mostly wait for cache misses.
+  // The gather and scatter in between can overlap them instead.
+  vector<ray> sorted(rays.size());
+  parallel_for(0, rays.size(), [&](size_t i) { sorted[i] = rays[order[i]]; });
+  auto sorted_results = make_unique_for_overwrite<type[]>(rays.size());
+
+  // Packets are fetched dynamically by the threads
+  // as the traversal costs of different regions vary a lot.
+  const auto packets = (rays.size() + packet_size - 1) / packet_size;
+  atomic<size_t> next = 0;
+  parallel_invoke(std::min(thread_count(), packets), [&](size_t) {
+    for (auto p = next++; p < packets; p = next++) {
+      const auto first = p * packet_size;
+      const auto last = std::min(first + packet_size, rays.size());
+      for (auto i = first; i < last; ++i)
+        sorted_results[i] = query(sorted[i], order[i]);
+    }
+  });
+
+  parallel_for(0, rays.size(),
+               [&](size_t i) { results[order[i]] = sorted_results[i]; });
+}
+
+void intersect(const bvh& tree,
+               span<const ray> rays,
+               span<ray_polyhedral_surface_intersection> results) {
+  coherent_queries(rays, results, [&](const ray& r, size_t) {
+    return intersection(r, tree);
+  });
+}
+
+void occluded(const bvh& tree,
+              span<const ray> rays,
+              span<const float32> tmax,
+              span<bool> results) {
+  assert(rays.size() == tmax.size());
+  coherent_queries(rays, results, [&](const ray& r, size_t i) {
+    return occluded(r, tree, tmax[i]);
+  });
+}
+
+namespace {
+
+// Squared distance of a point to a box which is zero inside of it
+//
+auto distance2(const vec3& p, const aabb3& box) noexcept {
+  return length2(max(max(box._min - p, p - box._max), vec3{0.0f}));
+}
+
+}  // namespace
+
+auto closest_point(const vec3& p, const bvh& tree) noexcept -> surface_point {
+  surface_point result{};
+  if (tree.empty()) return result;
+
+  const auto& nodes = tree.nodes;
+  const auto& blocks = tree.triangles;
+  const auto width = blocks.width;
+
+  // Nodes are visited nearest first and skipped
+  // if they cannot contain a closer point.
+  // Boxes at the same distance as the current closest point
+  // may still contain faces with smaller indices.
+  struct entry {
+    size_type node;
+    float32 d;
+  };
+  array<entry, bvh::stack_size> stack;
+  size_type top = 0;
+  stack[top++] = {0, distance2(p, nodes[0].box)};
+
+  while (top > 0) {
+    const auto [index, d] = stack[--top];
+    if (d > result.squared_distance) continue;
+    const auto& node = nodes[index];
+
+    if (node.leaf()) {
+      for (auto b = node.offset; b < node.offset + node.count; ++b) {
+        const auto block = blocks.block(b);
+        for (size_t lane = 0; lane < width; ++lane) {
+          const auto f = blocks.faces[b * width + lane];
+          if (f == polyhedral_surface::invalid) continue;
+          const auto component = [&](size_t i) {
+            return block[i * width + lane];
+          };
+          const auto x = closest_point(
+              p, {component(0), component(1), component(2)},
+              {component(3), component(4), component(5)},
+              {component(6), component(7), component(8)});
+          if (!((x.squared_distance < result.squared_distance) ||
+                ((x.squared_distance == result.squared_distance) &&
+                 (f < result.f))))
+            continue;
+          static_cast<triangle_point&>(result) = x;
+          result.f = f;
+        }
+      }
+      continue;
+    }
+
+    entry first{node.offset, distance2(p, nodes[node.offset].box)};
+    entry second{node.offset + 1, distance2(p, nodes[node.offset + 1].box)};
+    if (first.d > second.d) swap(first, second);
+    if (second.d <= result.squared_distance) stack[top++] = second;
+    if (first.d <= result.squared_distance) stack[top++] = first;
+  }
+  return result;
+}
+
+void closest_points(const bvh& tree,
+                    span<const vec3> points,
+                    span<surface_point> results) {
+  assert(points.size() == results.size());
+  parallel_for(
+      0, points.size(),
+      [&](size_t i) { results[i] = closest_point(points[i], tree); }, 1 << 8);
+}
+
+}  // namespace hyperreflex
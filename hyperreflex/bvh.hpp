@@ -0,0 +1,130 @@
+#pragma once
+#include <hyperreflex/closest_point.hpp>
+
+namespace hyperreflex {
+
+/// Bounding volume hierarchy over the faces of a polyhedral surface.
+/// It is built in parallel by using the binned surface area heuristic.
+/// Leaves store copies of their triangles in blocks for the SIMD kernel.
+/// So, ray queries do not need the surface itself.
+///
+struct bvh {
+  using size_type = uint32;
+
+  struct node {
+    auto leaf() const noexcept { return count > 0; }
+
+    aabb3 box{};
+    // For inner nodes, this is the index of the first child
+    // and both children are stored next to each other.
+    // For leaves, this is the index of the first triangle block.
+    size_type offset{};
+    // Number of triangle blocks in leaves and zero for inner nodes
+    size_type count{};
+  };
+
+  // Leaves contain at most this number of triangles
+  // or one block if the SIMD width is larger.
+  static constexpr size_type max_leaf_size = 8;
+  // Inner nodes below this depth are always split at the median.
+  // Together with the stack size, this bounds the traversal stack.
+  static constexpr size_type max_sah_depth = 64;
+  static constexpr size_type stack_size = 128;
+
+  auto empty() const noexcept { return nodes.empty(); }
+
+  vector<node> nodes{};
+  // SAH costs of all nodes relative to their own area
+  // at the time their subtree has been built
+  vector<float32> costs{};
+  // Triangles of all leaves in leaf order.
+  // Every leaf starts with a new block.
+  triangle_blocks triangles{};
+};
+
+/// Nodes of a BVH whose leaves refer to ranges of faces
+/// instead of blocks of triangles
+///
+struct bvh_topology {
+  vector<bvh::node> nodes{};
+  // Faces in leaf order. Leaves store the offset and count of their faces.
+  vector<polyhedral_surface::face_id> faces{};
+};
+
+/// Build the nodes of a BVH over all faces of the given surface
+/// with at most 'leaf_size' faces per leaf and leaf costs
+/// for faces that are tested in blocks of the given width.
+/// This is the first step of every BVH build.
+///
+auto bvh_topology_from(const polyhedral_surface& surface,
+                       size_t width,
+                       size_t leaf_size) -> bvh_topology;
+
+/// Build a BVH over all faces of the given surface
+/// whose leaves are tested by the SIMD kernel of the given width.
+///
+auto bvh_from(const polyhedral_surface& surface, size_t width = simd_width())
+    -> bvh;
+
+/// Number of bytes used by the nodes, costs, and triangles of the BVH
+///
+auto memory_usage(const bvh& tree) noexcept -> size_t;
+
+/// Update the BVH for new vertex positions of the faces it has been built for.
+/// The faces themselves must not have changed.
+/// All triangles and boxes are recomputed bottom-up in parallel
+/// while the tree structure is kept.
+/// Afterwards, subtrees whose SAH cost has grown by more than
+/// the given factor since their build are rebuilt over their leaves.
+/// The number of rebuilt subtrees is returned.
+///
+auto refit(bvh& tree,
+           span<const polyhedral_surface::vertex> vertices,
+           span<const polyhedral_surface::face> faces,
+           float32 rebuild_factor = infinity) -> size_t;
+
+/// Closest-hit query by traversing the BVH.
+/// The result is identical to the brute-force query on the surface.
+/// Among hits with equal distance, the face with the smallest index wins.
+///
+auto intersection(const ray& r, const bvh& tree) noexcept
+    -> ray_polyhedral_surface_intersection;
+
+/// Closest-hit queries for many rays at once.
+/// The rays are sorted by direction and origin for coherent traversals
+/// and packets of neighboring rays are distributed over all threads.
+/// Every result is identical to the one of the single-ray query.
+///
+void intersect(const bvh& tree,
+               span<const ray> rays,
+               span<ray_polyhedral_surface_intersection> results);
+
+/// Any-hit query that checks whether the ray hits some face
+/// in front of its origin and closer than 'tmax'.
+/// The traversal stops at the first hit that has been found.
+/// The result is the same as checking 'intersection(r, tree).t < tmax'.
+///
+auto occluded(const ray& r, const bvh& tree, float32 tmax = infinity) noexcept
+    -> bool;
+
+/// Any-hit queries for many rays at once with their own maximal distances.
+/// The rays are processed like the closest-hit queries for many rays.
+///
+void occluded(const bvh& tree,
+              span<const ray> rays,
+              span<const float32> tmax,
+              span<bool> results);
+
+/// Point of the surface closest to the given point found by the BVH.
+/// The result is identical to the brute-force query on the surface.
+///
+auto closest_point(const vec3& p, const bvh& tree) noexcept -> surface_point;
+
+/// Closest points of the surface for many points at once
+/// computed by all threads.
+///
+void closest_points(const bvh& tree,
+                    span<const vec3> points,
+                    span<surface_point> results);
+
+}  // namespace hyperreflex
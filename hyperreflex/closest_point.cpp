@@ -0,0 +1,79 @@
+#include <hyperreflex/closest_point.hpp>
+
+namespace hyperreflex {
+
+auto closest_point(const vec3& p,
+                   const vec3& origin,
+                   const vec3& edge1,
+                   const vec3& edge2) noexcept -> triangle_point {
+  // Voronoi regions of vertices, edges, and the face itself
+  // as in "Real-Time Collision Detection" by Christer Ericson.
+  // The vertices are 'a = origin', 'b = a + edge1', and 'c = a + edge2'.
+  //
+  const auto ap = p - origin;
+  const auto d1 = dot(edge1, ap);
+  const auto d2 = dot(edge2, ap);
+  const auto e11 = dot(edge1, edge1);
+  const auto e12 = dot(edge1, edge2);
+  const auto e22 = dot(edge2, edge2);
+  // Dot products of both edges with 'p - b' and 'p - c'
+  const auto d3 = d1 - e11;
+  const auto d4 = d2 - e12;
+  const auto d5 = d1 - e12;
+  const auto d6 = d2 - e22;
+
+  float32 u = 0;
+  float32 v = 0;
+  const auto vc = d1 * d4 - d3 * d2;
+  const auto vb = d5 * d2 - d1 * d6;
+  const auto va = d3 * d6 - d5 * d4;
+  if ((d1 <= 0) && (d2 <= 0)) {
+    // Vertex a
+  } else if ((d3 >= 0) && (d4 <= d3)) {
+    u = 1;
+  } else if ((vc <= 0) && (d1 >= 0) && (d3 <= 0)) {
+    u = d1 / (d1 - d3);
+  } else if ((d6 >= 0) && (d5 <= d6)) {
+    v = 1;
+  } else if ((vb <= 0) && (d2 >= 0) && (d6 <= 0)) {
+    v = d2 / (d2 - d6);
+  } else if ((va <= 0) && (d4 - d3 >= 0) && (d5 - d6 >= 0)) {
+    v = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    u = 1 - v;
+  } else {
+    const auto inverse_sum = 1.0f / (va + vb + vc);
+    u = vb * inverse_sum;
+    v = vc * inverse_sum;
+  }
+  return {u, v, length2(ap - u * edge1 - v * edge2)};
+}
+
+auto closest_point(const vec3& p, const triangle& t) noexcept
+    -> triangle_point {
+  return closest_point(p, t[0], t[1] - t[0], t[2] - t[0]);
+}
+
+auto closest_point(const vec3& p, const polyhedral_surface& surface) noexcept
+    -> surface_point {
+  surface_point result{};
+  const auto& v = surface.vertices;
+  for (size_t i = 0; i < surface.faces.size(); ++i) {
+    const auto& f = surface.faces[i];
+    const auto x = closest_point(
+        p, {v[f[0]].position, v[f[1]].position, v[f[2]].position});
+    if (!(x.squared_distance < result.squared_distance)) continue;
+    static_cast<triangle_point&>(result) = x;
+    result.f = i;
+  }
+  return result;
+}
+
+auto position_of(const polyhedral_surface& surface,
+                 const surface_point& p) noexcept -> vec3 {
+  const auto& f = surface.faces[p.f];
+  const auto& v = surface.vertices;
+  return (1 - p.u - p.v) * v[f[0]].position + p.u * v[f[1]].position +
+         p.v * v[f[2]].position;
+}
+
+}  // namespace hyperreflex
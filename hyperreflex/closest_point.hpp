@@ -0,0 +1,44 @@
+#pragma once
+#include <hyperreflex/ray_tracer.hpp>
+
+namespace hyperreflex {
+
+/// Point of a triangle closest to a query point
+/// given by the barycentric coordinates of the second and third vertex.
+///
+struct triangle_point {
+  float32 u{};
+  float32 v{};
+  float32 squared_distance = infinity;
+};
+
+/// Closest point of the triangle given by its first vertex and both edges
+/// as they are stored in triangle blocks.
+///
+auto closest_point(const vec3& p,
+                   const vec3& origin,
+                   const vec3& edge1,
+                   const vec3& edge2) noexcept -> triangle_point;
+
+auto closest_point(const vec3& p, const triangle& t) noexcept
+    -> triangle_point;
+
+/// Point of a surface closest to a query point.
+/// Among faces with equal distance, the one with the smallest index wins.
+///
+struct surface_point : triangle_point {
+  operator bool() const noexcept { return f != polyhedral_surface::invalid; }
+  polyhedral_surface::face_id f = polyhedral_surface::invalid;
+};
+
+/// Brute-force query that checks every face of the surface.
+///
+auto closest_point(const vec3& p, const polyhedral_surface& surface) noexcept
+    -> surface_point;
+
+/// Position of a point on the surface given by its face and coordinates.
+///
+auto position_of(const polyhedral_surface& surface,
+                 const surface_point& p) noexcept -> vec3;
+
+}  // namespace hyperreflex
@@ -0,0 +1,448 @@
+#include <hyperreflex/compressed_bvh.hpp>
+
+// Dequantized bounds have to be computed in the same way
+// by the builder and the traversal to be conservative.
+#pragma GCC optimize("fp-contract=off")
+
+namespace hyperreflex {
+
+namespace {
+
+using size_type = compressed_bvh::size_type;
+using vertex = polyhedral_surface::vertex;
+using face = polyhedral_surface::face;
+constexpr auto width = compressed_bvh::width;
+
+// The traversal uses the vector extensions of GCC and Clang
+// like the SIMD kernel. Other compilers, such as MSVC,
+// test the children and faces one after another.
+//
+#if defined(__GNUC__)
+#define HYPERREFLEX_VECTOR_EXTENSIONS
+#endif
+#if defined(__GNUC__) && !defined(__clang__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define HYPERREFLEX_TARGET_KERNELS
+#endif
+
+// Cell size of the quantization grid for the given exponent
+//
+inline auto scale_of(int8 exponent) noexcept {
+  return bit_cast<float32>(uint32(exponent + 127) << 23);
+}
+
+class compressed_bvh_builder {
+ public:
+  compressed_bvh_builder(const bvh_topology& binary,
+                         compressed_bvh& tree) noexcept
+      : binary{binary}, tree{tree} {}
+
+  void build() {
+    tree.faces.reserve(binary.faces.size());
+    tree.nodes.emplace_back();
+    build(0, 0);
+  }
+
+ private:
+  struct children {
+    array<size_type, width> nodes;
+    size_t count;
+  };
+
+  // Replace the inner node with the largest surface area by its children
+  // until there are enough children or only leaves are left.
+  //
+  auto children_of(size_type index) const -> children {
+    const auto& n = binary.nodes[index];
+    if (n.leaf()) return {{index}, 1};
+    children result{{n.offset, n.offset + 1}, 2};
+    while (result.count < width) {
+      size_t best = width;
+      float32 best_area = -1.0f;
+      for (size_t i = 0; i < result.count; ++i) {
+        const auto& c = binary.nodes[result.nodes[i]];
+        if (c.leaf()) continue;
+        const auto d = c.box._max - c.box._min;
+        const auto a = d.x * d.y + d.y * d.z + d.z * d.x;
+        if (a <= best_area) continue;
+        best = i;
+        best_area = a;
+      }
+      if (best == width) break;
+      const auto& c = binary.nodes[result.nodes[best]];
+      result.nodes[best] = c.offset;
+      result.nodes[result.count++] = c.offset + 1;
+    }
+    return result;
+  }
+
+  void build(size_type binary_index, size_type index) {
+    const auto children = children_of(binary_index);
+
+    compressed_bvh::node node{};
+    node.child_offset = tree.nodes.size();
+    node.face_offset = tree.faces.size();
+    array<size_type, width> inner{};
+    size_t inner_count = 0;
+    uint8 faces = 0;
+    for (size_t i = 0; i < width; ++i) {
+      if (i < children.count) {
+        const auto& c = binary.nodes[children.nodes[i]];
+        if (c.leaf()) {
+          tree.faces.insert(tree.faces.end(), binary.faces.begin() + c.offset,
+                            binary.faces.begin() + c.offset + c.count);
+          faces += c.count;
+        } else {
+          node.inner_mask |= 1u << i;
+          inner[inner_count++] = children.nodes[i];
+        }
+      }
+      node.face_ends[i] = faces;
+    }
+    quantize(node, children);
+
+    tree.nodes.resize(tree.nodes.size() + inner_count);
+    tree.nodes[index] = node;
+    for (size_t i = 0; i < inner_count; ++i)
+      build(inner[i], node.child_offset + i);
+  }
+
+  // Quantize the child boxes to the smallest grid of 256 cells per axis
+  // starting at the minimum of their union.
+  // The quantized boxes enclose the original ones.
+  //
+  void quantize(compressed_bvh::node& node, const children& children) {
+    auto box = binary.nodes[children.nodes[0]].box;
+    for (size_t i = 1; i < children.count; ++i)
+      box = aabb(box, binary.nodes[children.nodes[i]].box);
+    node.origin = box._min;
+
+    for (int k = 0; k < 3; ++k) {
+      const auto origin = node.origin[k];
+      int exponent;
+      frexp((box._max[k] - origin) / 255.0f, &exponent);
+      exponent = std::max(exponent, -126);
+      for (;; ++exponent) {
+        const auto scale = scale_of(exponent);
+        bool fits = true;
+        for (size_t i = 0; i < children.count; ++i) {
+          const auto& b = binary.nodes[children.nodes[i]].box;
+          auto lower = std::clamp(floor((b._min[k] - origin) / scale), 0.0f,
+                                  255.0f);
+          auto upper = ceil((b._max[k] - origin) / scale);
+          while ((lower > 0) && (origin + lower * scale > b._min[k])) --lower;
+          while ((upper <= 255) && (origin + upper * scale < b._max[k]))
+            ++upper;
+          if (upper > 255) {
+            fits = false;
+            break;
+          }
+          node.lower[k][i] = lower;
+          node.upper[k][i] = upper;
+        }
+        if (fits) break;
+      }
+      node.exponents[k] = exponent;
+    }
+  }
+
+  const bvh_topology& binary;
+  compressed_bvh& tree;
+};
+
+// To not miss any hit that the triangle test would find,
+// the distances are enlarged by a small relative tolerance.
+//
+constexpr float32 slack = 1.0f + 1e-5f;
+
+// Update the closest hit by a hit of the given face.
+// For equal distances, the smaller face index wins.
+//
+inline void update(ray_polyhedral_surface_intersection& result,
+                   float32 u,
+                   float32 v,
+                   float32 t,
+                   polyhedral_surface::face_id f) noexcept {
+  if (!((t < result.t) || ((t == result.t) && result && (f < result.f))))
+    return;
+  result.u = u;
+  result.v = v;
+  result.t = t;
+  result.f = f;
+}
+
+#ifdef HYPERREFLEX_VECTOR_EXTENSIONS
+
+// Eight floats and bytes for the child boxes of a node
+using floats = float32 __attribute__((vector_size(width * sizeof(float32))));
+using bytes = uint8 __attribute__((vector_size(width)));
+
+// Möller–Trumbore test of one ray against up to eight faces of a leaf
+// whose vertices are gathered into vectors first.
+// Edges and products are computed in the same order as the scalar test
+// such that all hits are bit-identical to it.
+// It is inlined to use the instruction set of the traversal.
+//
+[[gnu::always_inline]] inline void intersect_faces(
+    const ray& r,
+    const polyhedral_surface::face_id* faces,
+    size_type count,
+    span<const vertex> vertices,
+    span<const face> surface_faces,
+    ray_polyhedral_surface_intersection& result) noexcept {
+  floats v0x{}, v0y{}, v0z{}, e1x{}, e1y{}, e1z{}, e2x{}, e2y{}, e2z{};
+  for (size_type i = 0; i < count; ++i) {
+    const auto& face = surface_faces[faces[i]];
+    const auto& v0 = vertices[face[0]].position;
+    const auto edge1 = vertices[face[1]].position - v0;
+    const auto edge2 = vertices[face[2]].position - v0;
+    v0x[i] = v0.x;
+    v0y[i] = v0.y;
+    v0z[i] = v0.z;
+    e1x[i] = edge1.x;
+    e1y[i] = edge1.y;
+    e1z[i] = edge1.z;
+    e2x[i] = edge2.x;
+    e2y[i] = edge2.y;
+    e2z[i] = edge2.z;
+  }
+
+  const auto dx = r.direction.x;
+  const auto dy = r.direction.y;
+  const auto dz = r.direction.z;
+  // p = cross(direction, edge2)
+  const floats px = dy * e2z - e2y * dz;
+  const floats py = dz * e2x - e2z * dx;
+  const floats pz = dx * e2y - e2x * dy;
+  // determinant = dot(edge1, p)
+  const floats determinant = e1x * px + e1y * py + e1z * pz;
+  const floats inverse_determinant = 1.0f / determinant;
+  // s = origin - v0
+  const floats sx = r.origin.x - v0x;
+  const floats sy = r.origin.y - v0y;
+  const floats sz = r.origin.z - v0z;
+  const floats u = (sx * px + sy * py + sz * pz) * inverse_determinant;
+  // q = cross(s, edge1)
+  const floats qx = sy * e1z - e1y * sz;
+  const floats qy = sz * e1x - e1z * sx;
+  const floats qz = sx * e1y - e1x * sy;
+  const floats v = (dx * qx + dy * qy + dz * qz) * inverse_determinant;
+  const floats t = (e2x * qx + e2y * qy + e2z * qz) * inverse_determinant;
+
+  // Unused lanes have a zero determinant.
+  const auto hit = (determinant != 0.0f) & (u >= 0.0f) & (v >= 0.0f) &
+                   (u + v <= 1.0f) & (t > 0.0f) & (t <= result.t);
+  for (size_type i = 0; i < count; ++i)
+    if (hit[i]) update(result, u[i], v[i], t[i], faces[i]);
+}
+
+// Test all child boxes of a node at once.
+// Bit 'i' of the result is set if child 'i' is hit
+// and its entry distance is stored in 'enter[i]'.
+//
+[[gnu::always_inline]] inline auto intersect_children(
+    const compressed_bvh::node& node,
+    const ray& r,
+    const vec3& inverse_direction,
+    float32 tmax,
+    array<float32, width>& enter) noexcept -> uint32 {
+  floats near_max = floats{} + 0.0f;
+  floats far_min = floats{} + tmax;
+  for (int k = 0; k < 3; ++k) {
+    bytes lower, upper;
+    memcpy(&lower, node.lower[k].data(), sizeof(bytes));
+    memcpy(&upper, node.upper[k].data(), sizeof(bytes));
+    const auto scale = scale_of(node.exponents[k]);
+    const floats low =
+        node.origin[k] + __builtin_convertvector(lower, floats) * scale;
+    const floats high =
+        node.origin[k] + __builtin_convertvector(upper, floats) * scale;
+    const floats a = (low - r.origin[k]) * inverse_direction[k];
+    const floats b = (high - r.origin[k]) * inverse_direction[k];
+    const floats near = (a < b) ? a : b;
+    const floats far = ((a < b) ? b : a) * slack;
+    near_max = (near_max < near) ? near : near_max;
+    far_min = (far < far_min) ? far : far_min;
+  }
+  const auto hit = near_max <= far_min;
+  uint32 mask = 0;
+  for (size_t i = 0; i < width; ++i) {
+    mask |= uint32(hit[i] & 1) << i;
+    enter[i] = near_max[i];
+  }
+  return mask;
+}
+
+#else
+
+// Scalar variant which tests the faces of a leaf one after another
+// by the scalar triangle test.
+//
+inline void intersect_faces(
+    const ray& r,
+    const polyhedral_surface::face_id* faces,
+    size_type count,
+    span<const vertex> vertices,
+    span<const face> surface_faces,
+    ray_polyhedral_surface_intersection& result) noexcept {
+  for (size_type i = 0; i < count; ++i) {
+    const auto& f = surface_faces[faces[i]];
+    const auto p = intersection(
+        r, triangle{vertices[f[0]].position, vertices[f[1]].position,
+                    vertices[f[2]].position});
+    if (p && (p.t <= result.t)) update(result, p.u, p.v, p.t, faces[i]);
+  }
+}
+
+// Scalar variant with the same operations for every child box
+//
+inline auto intersect_children(const compressed_bvh::node& node,
+                               const ray& r,
+                               const vec3& inverse_direction,
+                               float32 tmax,
+                               array<float32, width>& enter) noexcept
+    -> uint32 {
+  uint32 mask = 0;
+  for (size_t i = 0; i < width; ++i) {
+    float32 near_max = 0.0f;
+    float32 far_min = tmax;
+    for (int k = 0; k < 3; ++k) {
+      const auto scale = scale_of(node.exponents[k]);
+      const float32 low = node.origin[k] + float32(node.lower[k][i]) * scale;
+      const float32 high = node.origin[k] + float32(node.upper[k][i]) * scale;
+      const float32 a = (low - r.origin[k]) * inverse_direction[k];
+      const float32 b = (high - r.origin[k]) * inverse_direction[k];
+      const float32 near = (a < b) ? a : b;
+      const float32 far = ((a < b) ? b : a) * slack;
+      near_max = (near_max < near) ? near : near_max;
+      far_min = (far < far_min) ? far : far_min;
+    }
+    if (near_max <= far_min) mask |= uint32{1} << i;
+    enter[i] = near_max;
+  }
+  return mask;
+}
+
+#endif
+
+// Traversal that tests all child boxes of a node at once.
+// It is instantiated below for its own instruction set like the kernels.
+//
+template <int isa>
+auto traverse(const ray& r,
+              const compressed_bvh& tree,
+              span<const vertex> vertices,
+              span<const face> faces) noexcept
+    -> ray_polyhedral_surface_intersection {
+  ray_query_statistics statistics{};
+  ray_polyhedral_surface_intersection result{};
+  result.t = infinity;
+  if (tree.empty()) return result;
+
+  // Zero direction components get a large finite inverse.
+  // Then, the box test cannot produce NaNs
+  // and at most tests a few more boxes than needed.
+  vec3 inverse_direction;
+  for (int k = 0; k < 3; ++k)
+    inverse_direction[k] = (r.direction[k] != 0.0f)
+                               ? 1.0f / r.direction[k]
+                               : numeric_limits<float32>::max();
+
+  // Leaves are pushed with their faces and inner nodes without.
+  struct entry_type {
+    size_type index;
+    size_type count;
+    float32 t;
+  };
+  array<entry_type, compressed_bvh::stack_size> stack;
+  size_type top = 0;
+  stack[top++] = {0, 0, 0.0f};
+
+  while (top > 0) {
+    const auto [index, count, t] = stack[--top];
+    const auto tmax = result.t * slack;
+    if (t > tmax) continue;
+    statistics.visit_node();
+
+    if (count > 0) {
+      statistics.test_triangles(count);
+      intersect_faces(r, tree.faces.data() + index, count, vertices, faces,
+                      result);
+      continue;
+    }
+
+    const auto& node = tree.nodes[index];
+    array<float32, width> enter;
+    auto mask = intersect_children(node, r, inverse_direction, tmax, enter);
+
+    // Children are pushed by decreasing distance
+    // such that the nearest one is visited first.
+    array<entry_type, width> children;
+    size_t children_count = 0;
+    for (; mask; mask &= mask - 1) {
+      const auto i = countr_zero(mask);
+      const auto first = (i > 0) ? node.face_ends[i - 1] : 0;
+      const size_type face_count = node.face_ends[i] - first;
+      entry_type child{};
+      if ((node.inner_mask >> i) & 1u) {
+        const auto preceding = node.inner_mask & ((1u << i) - 1);
+        child = {node.child_offset + popcount(preceding), 0, enter[i]};
+      } else if (face_count > 0) {
+        child = {node.face_offset + first, face_count, enter[i]};
+      } else {
+        continue;
+      }
+      auto j = children_count++;
+      for (; (j > 0) && (children[j - 1].t < child.t); --j)
+        children[j] = children[j - 1];
+      children[j] = child;
+    }
+    for (size_t i = 0; i < children_count; ++i) stack[top++] = children[i];
+  }
+  statistics.hit(result);
+  return result;
+}
+
+#ifdef HYPERREFLEX_TARGET_KERNELS
+template auto traverse<0>(const ray&,
+                          const compressed_bvh&,
+                          span<const vertex>,
+                          span<const face>) noexcept
+    -> ray_polyhedral_surface_intersection;
+#pragma GCC push_options
+#pragma GCC target("avx2")
+template auto traverse<1>(const ray&,
+                          const compressed_bvh&,
+                          span<const vertex>,
+                          span<const face>) noexcept
+    -> ray_polyhedral_surface_intersection;
+#pragma GCC pop_options
+#endif
+
+}  // namespace
+
+auto compressed_bvh_from(const polyhedral_surface& surface) -> compressed_bvh {
+  compressed_bvh tree{};
+  if (surface.faces.empty()) return tree;
+  // The faces of a leaf are tested at once by one vector.
+  const auto binary = bvh_topology_from(surface, width, width);
+  compressed_bvh_builder{binary, tree}.build();
+  return tree;
+}
+
+auto memory_usage(const compressed_bvh& tree) noexcept -> size_t {
+  return tree.nodes.size() * sizeof(compressed_bvh::node) +
+         tree.faces.size() * sizeof(polyhedral_surface::face_id);
+}
+
+auto intersection(const ray& r,
+                  const compressed_bvh& tree,
+                  span<const polyhedral_surface::vertex> vertices,
+                  span<const polyhedral_surface::face> faces) noexcept
+    -> ray_polyhedral_surface_intersection {
+  // The wider vectors are only used if the processor supports them.
+  if (simd_width() >= 8) return traverse<1>(r, tree, vertices, faces);
+  return traverse<0>(r, tree, vertices, faces);
+}
+
+}  // namespace hyperreflex
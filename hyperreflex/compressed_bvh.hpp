@@ -0,0 +1,90 @@
+#pragma once
+#include <hyperreflex/bvh.hpp>
+
+namespace hyperreflex {
+
+/// Compressed BVH with up to eight children per node
+/// whose boxes are quantized to 8 bits relative to their parent.
+/// Leaves store no triangles but only refer to the faces of the surface.
+/// So, it needs a fraction of the memory of the binary BVH
+/// but queries need the surface it has been built for.
+///
+struct compressed_bvh {
+  using size_type = uint32;
+
+  static constexpr size_type width = 8;
+  // Every node pushes at most all but one of its children.
+  static constexpr size_type stack_size = (width - 1) * bvh::stack_size + 1;
+
+  struct node {
+    // The quantization grid of the children starts at the origin
+    // and uses a power-of-two cell size for every axis.
+    vec3 origin{};
+    array<int8, 3> exponents{};
+    // Bit 'i' is set if child 'i' is an inner node.
+    uint8 inner_mask{};
+    // Index of the first inner child. All inner children follow it.
+    size_type child_offset{};
+    // Index of the first face of all leaf children in child order
+    size_type face_offset{};
+    // Number of faces of the children up to and including 'i'.
+    // Unused children are neither inner nodes nor do they have faces.
+    array<uint8, width> face_ends{};
+    // Quantized bounds of all children for every axis
+    array<array<uint8, width>, 3> lower{};
+    array<array<uint8, width>, 3> upper{};
+  };
+
+  auto empty() const noexcept { return nodes.empty(); }
+
+  vector<node> nodes{};
+  // Faces of all leaves in leaf order
+  vector<polyhedral_surface::face_id> faces{};
+};
+
+static_assert(sizeof(compressed_bvh::node) == 80);
+
+/// Surfaces with at least this number of faces use the compressed BVH
+/// for picking and rendering in the viewer and the headless renderer.
+/// The triangle blocks of the binary BVH take about 50 bytes per face
+/// which would otherwise exceed the memory of the surface itself.
+///
+constexpr size_t compressed_bvh_face_threshold = size_t{1} << 22;
+
+/// Check whether picking and rendering should use the compressed BVH.
+///
+inline auto prefers_compressed_bvh(const polyhedral_surface& surface) noexcept
+    -> bool {
+  return surface.faces.size() >= compressed_bvh_face_threshold;
+}
+
+/// Build a compressed BVH by collapsing a binary BVH of the surface.
+///
+auto compressed_bvh_from(const polyhedral_surface& surface) -> compressed_bvh;
+
+/// Number of bytes used by the nodes and faces of the BVH
+///
+auto memory_usage(const compressed_bvh& tree) noexcept -> size_t;
+
+/// Closest-hit query by traversing the compressed BVH
+/// where all eight child boxes of a node are tested at once.
+/// The vertices and faces have to be the ones the BVH has been built for.
+/// The result is identical to the brute-force query on the surface.
+///
+auto intersection(const ray& r,
+                  const compressed_bvh& tree,
+                  span<const polyhedral_surface::vertex> vertices,
+                  span<const polyhedral_surface::face> faces) noexcept
+    -> ray_polyhedral_surface_intersection;
+
+/// Closest-hit query by traversing the compressed BVH
+/// which has been built for the given surface.
+///
+inline auto intersection(const ray& r,
+                         const compressed_bvh& tree,
+                         const polyhedral_surface& surface) noexcept
+    -> ray_polyhedral_surface_intersection {
+  return intersection(r, tree, span{surface.vertices}, span{surface.faces});
+}
+
+}  // namespace hyperreflex
@@ -0,0 +1,348 @@
+#include <hyperreflex/heat_cache.hpp>
+//
+#include <hyperreflex/memory_mapped_file.hpp>
+
+namespace hyperreflex {
+
+namespace {
+
+constexpr array<char, 8> heat_cache_magic{'h', 'y', 'p', 'e',
+                                          'r', 'h', 't', 'x'};
+
+struct heat_cache_header {
+  array<char, 8> magic;
+  uint32 version;
+  uint32 endianness;
+  uint64 key;
+  uint64 topology_key;
+  float64 time_step;
+  uint64 vertex_count;
+  uint64 face_count;
+  uint64 fixed_count;
+  uint64 heat_flow_supernodes;
+  uint64 heat_flow_rows;
+  uint64 heat_flow_values;
+  uint64 poisson_supernodes;
+  uint64 poisson_rows;
+  uint64 poisson_values;
+};
+
+using real = heat_method::real_type;
+
+// Offsets of the arrays of a symbolic analysis
+//
+struct cholesky_analysis_layout {
+  size_t permutation;
+  size_t supernodes;
+  size_t row_offsets;
+  size_t rows;
+  size_t value_offsets;
+};
+
+// The cache file consists of the header followed by the masses,
+// the cotangents, the fixed vertices, both analyses, and both factors.
+// The analyses are stored before the factors
+// such that they can be read on their own.
+// Every section starts at a multiple of the cache line size.
+//
+struct heat_cache_layout {
+  static constexpr size_t alignment = 64;
+
+  static constexpr auto aligned(size_t offset) noexcept {
+    return (offset + alignment - 1) / alignment * alignment;
+  }
+
+  constexpr heat_cache_layout(const heat_cache_header& header) noexcept {
+    using index_type = cholesky_analysis::index_type;
+    size_t offset = sizeof(heat_cache_header);
+    const auto section = [&](size_t bytes) {
+      const auto result = aligned(offset);
+      offset = result + bytes;
+      return result;
+    };
+    const auto analysis = [&](size_t supernodes, size_t rows) {
+      cholesky_analysis_layout result{};
+      result.permutation = section(header.vertex_count * sizeof(index_type));
+      result.supernodes = section((supernodes + 1) * sizeof(index_type));
+      result.row_offsets = section((supernodes + 1) * sizeof(index_type));
+      result.rows = section(rows * sizeof(index_type));
+      result.value_offsets = section((supernodes + 1) * sizeof(uint64));
+      return result;
+    };
+    masses = section(header.vertex_count * sizeof(real));
+    cotangents = section(header.face_count * sizeof(array<real, 3>));
+    fixed_vertices = section(header.fixed_count *
+                             sizeof(polyhedral_surface::vertex_id));
+    heat_flow_analysis =
+        analysis(header.heat_flow_supernodes, header.heat_flow_rows);
+    poisson_analysis = analysis(header.poisson_supernodes, header.poisson_rows);
+    heat_flow = section(header.heat_flow_values * sizeof(float64));
+    poisson = section(header.poisson_values * sizeof(real));
+    size = offset;
+  }
+
+  size_t masses;
+  size_t cotangents;
+  size_t fixed_vertices;
+  cholesky_analysis_layout heat_flow_analysis;
+  cholesky_analysis_layout poisson_analysis;
+  size_t heat_flow;
+  size_t poisson;
+  size_t size;
+};
+
+// FNV-1a on 64-bit words with the remaining bytes as last word
+//
+constexpr uint64 fnv_prime = 0x100000001b3;
+constexpr uint64 fnv_offset = 0xcbf29ce484222325;
+
+auto hash(uint64 state, const void* data, size_t size) noexcept {
+  const auto bytes = static_cast<const char*>(data);
+  size_t i = 0;
+  for (; i + sizeof(uint64) <= size; i += sizeof(uint64)) {
+    uint64 word;
+    memcpy(&word, bytes + i, sizeof(word));
+    state = (state ^ word) * fnv_prime;
+  }
+  if (i < size) {
+    uint64 word = 0;
+    memcpy(&word, bytes + i, size - i);
+    state = (state ^ word) * fnv_prime;
+  }
+  return state;
+}
+
+// Check that the analysis describes a valid partition into supernodes
+// whose rows start with their own columns and are sorted and in range.
+// Solves can then not access invalid memory.
+//
+auto valid(const cholesky_analysis& analysis) noexcept {
+  const auto n = analysis.size();
+  const auto& supernodes = analysis.supernodes;
+  const auto& offsets = analysis.row_offsets;
+  if ((supernodes.front() != 0) || (size_t(supernodes.back()) != n) ||
+      (ranges::adjacent_find(supernodes, greater_equal{}) !=
+       supernodes.end()) ||
+      (offsets.front() != 0) ||
+      (size_t(offsets.back()) != analysis.rows.size()) ||
+      (ranges::adjacent_find(offsets, greater_equal{}) != offsets.end()) ||
+      (analysis.value_offsets.front() != 0))
+    return false;
+
+  vector<bool> visited(n);
+  for (auto i : analysis.permutation) {
+    if ((i < 0) || (size_t(i) >= n) || visited[i]) return false;
+    visited[i] = true;
+  }
+  for (size_t s = 0; s < analysis.supernode_count(); ++s) {
+    const auto first = supernodes[s];
+    const auto last = supernodes[s + 1];
+    if (offsets[s + 1] - offsets[s] < last - first) return false;
+    const auto rows = span{analysis.rows}.subspan(
+        offsets[s], offsets[s + 1] - offsets[s]);
+    for (auto j = first; j < last; ++j)
+      if (rows[j - first] != j) return false;
+    if ((ranges::adjacent_find(rows, greater_equal{}) != rows.end()) ||
+        (size_t(rows.back()) >= n))
+      return false;
+    if (analysis.value_offsets[s + 1] - analysis.value_offsets[s] !=
+        uint64(rows.size()) * (last - first))
+      return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+auto heat_cache::path_of(const filesystem::path& source) -> filesystem::path {
+  auto result = source;
+  result += ".heat.hyperreflex";
+  return result;
+}
+
+auto heat_cache::key_of(const polyhedral_surface& surface, float64 time_step)
+    -> uint64 {
+  // Normals do not change the heat method.
+  // So, only positions are taken into account.
+  auto result = fnv_offset;
+  for (const auto& v : surface.vertices)
+    result = hash(result, &v.position, sizeof(v.position));
+  result = hash(result, surface.faces.data(),
+                surface.faces.size() * sizeof(polyhedral_surface::face));
+  return hash(result, &time_step, sizeof(time_step));
+}
+
+auto heat_cache::topology_key_of(const polyhedral_surface& surface)
+    -> uint64 {
+  const uint64 n = surface.vertices.size();
+  return hash(hash(fnv_offset, &n, sizeof(n)), surface.faces.data(),
+              surface.faces.size() * sizeof(polyhedral_surface::face));
+}
+
+namespace {
+
+// Read the header of a cache file whose size has to fit the header.
+//
+auto read_header(const memory_mapped_file& file)
+    -> optional<heat_cache_header> {
+  heat_cache_header header;
+  if (file.size() < sizeof(header)) return {};
+  memcpy(&header, file.data(), sizeof(header));
+  if ((header.magic != heat_cache_magic) ||
+      (header.version != heat_cache::version) ||
+      (header.endianness != uint32(endian::native)))
+    return {};
+  // Huge counts of a broken header would overflow the layout.
+  for (auto count :
+       {header.vertex_count, header.face_count, header.fixed_count,
+        header.heat_flow_supernodes, header.heat_flow_rows,
+        header.heat_flow_values, header.poisson_supernodes,
+        header.poisson_rows, header.poisson_values})
+    if (count > file.size()) return {};
+  if (file.size() != heat_cache_layout{header}.size) return {};
+  return header;
+}
+
+void read(const memory_mapped_file& file,
+          size_t offset,
+          auto& data,
+          size_t count) {
+  data.resize(count);
+  memcpy(data.data(), file.data() + offset, count * sizeof(data[0]));
+}
+
+auto read_analysis(const memory_mapped_file& file,
+                   const heat_cache_header& header) -> optional<heat_analysis> {
+  const heat_cache_layout layout{header};
+  const auto read_cholesky = [&](const cholesky_analysis_layout& layout,
+                                 size_t supernodes, size_t rows,
+                                 cholesky_analysis& analysis) {
+    read(file, layout.permutation, analysis.permutation, header.vertex_count);
+    read(file, layout.supernodes, analysis.supernodes, supernodes + 1);
+    read(file, layout.row_offsets, analysis.row_offsets, supernodes + 1);
+    read(file, layout.rows, analysis.rows, rows);
+    read(file, layout.value_offsets, analysis.value_offsets, supernodes + 1);
+  };
+
+  heat_analysis result{};
+  read(file, layout.fixed_vertices, result.fixed_vertices, header.fixed_count);
+  read_cholesky(layout.heat_flow_analysis, header.heat_flow_supernodes,
+                header.heat_flow_rows, result.heat_flow);
+  read_cholesky(layout.poisson_analysis, header.poisson_supernodes,
+                header.poisson_rows, result.poisson);
+
+  // Broken indices would let solves access invalid memory.
+  const auto n = header.vertex_count;
+  if (!valid(result.heat_flow) || !valid(result.poisson) ||
+      ranges::any_of(result.fixed_vertices, [n](auto i) { return i >= n; }))
+    return {};
+  return result;
+}
+
+}  // namespace
+
+auto load_heat_cache(const filesystem::path& source, uint64 key)
+    -> optional<heat_method> try {
+  const auto path = heat_cache::path_of(source);
+  if (!exists(path)) return {};
+
+  const memory_mapped_file file{path};
+  const auto header = read_header(file);
+  if (!header || (header->key != key)) return {};
+  auto analysis = read_analysis(file, *header);
+  if (!analysis ||
+      (analysis->heat_flow.value_count() != header->heat_flow_values) ||
+      (analysis->poisson.value_count() != header->poisson_values))
+    return {};
+
+  const heat_cache_layout layout{*header};
+  heat_method result{.time_step = header->time_step,
+                     .analysis = std::move(*analysis)};
+  read(file, layout.masses, result.masses, header->vertex_count);
+  read(file, layout.cotangents, result.cotangents, header->face_count);
+  read(file, layout.heat_flow, result.heat_flow.values,
+       header->heat_flow_values);
+  read(file, layout.poisson, result.poisson.values, header->poisson_values);
+  return result;
+} catch (const exception&) {
+  // A cache that cannot be read is treated like a missing one.
+  return {};
+}
+
+auto load_heat_analysis(const filesystem::path& source, uint64 topology_key)
+    -> optional<heat_analysis> try {
+  const auto path = heat_cache::path_of(source);
+  if (!exists(path)) return {};
+
+  const memory_mapped_file file{path};
+  const auto header = read_header(file);
+  if (!header || (header->topology_key != topology_key)) return {};
+  return read_analysis(file, *header);
+} catch (const exception&) {
+  return {};
+}
+
+void save_heat_cache(const filesystem::path& source,
+                     uint64 key,
+                     uint64 topology_key,
+                     const heat_method& method) {
+  const auto path = heat_cache::path_of(source);
+  auto tmp = path;
+  tmp += ".tmp";
+
+  const auto& analysis = method.analysis;
+  const heat_cache_header header{
+      .magic = heat_cache_magic,
+      .version = heat_cache::version,
+      .endianness = uint32(endian::native),
+      .key = key,
+      .topology_key = topology_key,
+      .time_step = method.time_step,
+      .vertex_count = method.masses.size(),
+      .face_count = method.cotangents.size(),
+      .fixed_count = analysis.fixed_vertices.size(),
+      .heat_flow_supernodes = analysis.heat_flow.supernode_count(),
+      .heat_flow_rows = analysis.heat_flow.rows.size(),
+      .heat_flow_values = method.heat_flow.values.size(),
+      .poisson_supernodes = analysis.poisson.supernode_count(),
+      .poisson_rows = analysis.poisson.rows.size(),
+      .poisson_values = method.poisson.values.size(),
+  };
+  const heat_cache_layout layout{header};
+
+  {
+    fstream file{tmp, ios::out | ios::binary | ios::trunc};
+    if (!file.is_open())
+      throw runtime_error("Failed to open heat cache file '"s + tmp.string() +
+                          "' for writing.");
+    const auto write = [&](size_t offset, const auto& data) {
+      // Fill the gap to the aligned start of the section with zeros.
+      const auto position = size_t(file.tellp());
+      for (auto i = position; i < offset; ++i) file.put('\0');
+      file.write(reinterpret_cast<const char*>(data.data()),
+                 data.size() * sizeof(data[0]));
+    };
+    const auto write_analysis = [&](const cholesky_analysis_layout& layout,
+                                    const cholesky_analysis& analysis) {
+      write(layout.permutation, analysis.permutation);
+      write(layout.supernodes, analysis.supernodes);
+      write(layout.row_offsets, analysis.row_offsets);
+      write(layout.rows, analysis.rows);
+      write(layout.value_offsets, analysis.value_offsets);
+    };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write(layout.masses, method.masses);
+    write(layout.cotangents, method.cotangents);
+    write(layout.fixed_vertices, analysis.fixed_vertices);
+    write_analysis(layout.heat_flow_analysis, analysis.heat_flow);
+    write_analysis(layout.poisson_analysis, analysis.poisson);
+    write(layout.heat_flow, method.heat_flow.values);
+    write(layout.poisson, method.poisson.values);
+    if (!file)
+      throw runtime_error("Failed to write heat cache file '"s +
+                          tmp.string() + "'.");
+  }
+  rename(tmp, path);
+}
+
+}  // namespace hyperreflex
@@ -0,0 +1,53 @@
+#pragma once
+#include <hyperreflex/heat_method.hpp>
+
+namespace hyperreflex {
+
+// The factorizations of the heat method take much longer
+// than loading the surface itself.
+// So, they are stored in a binary cache file next to the source file.
+// The factorizations are only valid for the exact same vertex positions,
+// faces, and time step which are identified by a hash of all of them.
+// Their symbolic analysis only depends on the faces.
+// It is identified by its own hash and is reused
+// if the factorizations cannot be used anymore.
+//
+struct heat_cache {
+  static constexpr uint32 version = 2;
+
+  // The cache file for 'model.stl' is 'model.stl.heat.hyperreflex'.
+  //
+  static auto path_of(const filesystem::path& source) -> filesystem::path;
+
+  // Hash of the vertex positions, the faces, and the time step
+  //
+  static auto key_of(const polyhedral_surface& surface, float64 time_step)
+      -> uint64;
+
+  // Hash of the vertex count and the faces
+  //
+  static auto topology_key_of(const polyhedral_surface& surface) -> uint64;
+};
+
+/// Load the heat method for the given key by memory-mapping its cache.
+/// If there is no cache or if it belongs to another key or is broken,
+/// nothing is returned and the heat method needs to be computed.
+///
+auto load_heat_cache(const filesystem::path& source, uint64 key)
+    -> optional<heat_method>;
+
+/// Load only the symbolic analysis of the heat method
+/// for the given topology key from its cache.
+///
+auto load_heat_analysis(const filesystem::path& source, uint64 topology_key)
+    -> optional<heat_analysis>;
+
+/// Write the cache of the heat method for the given keys.
+/// The file is written to a temporary path first and then renamed.
+///
+void save_heat_cache(const filesystem::path& source,
+                     uint64 key,
+                     uint64 topology_key,
+                     const heat_method& method);
+
+}  // namespace hyperreflex
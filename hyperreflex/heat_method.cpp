@@ -0,0 +1,398 @@
+#include <hyperreflex/heat_method.hpp>
+//
+#include <hyperreflex/parallel.hpp>
+
+namespace hyperreflex {
+
+namespace {
+
+using vertex_id = polyhedral_surface::vertex_id;
+
+template <typename real>
+using vector3 = glm::vec<3, real>;
+
+template <typename real = float64>
+auto positions_of(const polyhedral_surface& surface,
+                  const polyhedral_surface::face& face) noexcept {
+  const auto& v = surface.vertices;
+  return array<vector3<real>, 3>{vector3<real>(v[face[0]].position),
+                                 vector3<real>(v[face[1]].position),
+                                 vector3<real>(v[face[2]].position)};
+}
+
+// Cotangents of the corner angles of a face.
+// Degenerate faces get zero cotangents and do not contribute at all.
+//
+auto cotangents_of(const array<dvec3, 3>& p) noexcept {
+  array<float64, 3> result{};
+  for (int i = 0; i < 3; ++i) {
+    const auto a = p[(i + 1) % 3] - p[i];
+    const auto b = p[(i + 2) % 3] - p[i];
+    const auto sine = length(cross(a, b));
+    result[i] = (sine > 0) ? dot(a, b) / sine : 0.0;
+  }
+  return result;
+}
+
+// Entries of the cotangent Laplacian which is positive semi-definite.
+// The edge opposite to corner 'i' of face 'f' gets 'weight(f, i)'.
+// Entries are emitted for all edges even if their weight is zero.
+// So, the pattern does not depend on the vertex positions.
+//
+template <typename real>
+void add_laplacian(const polyhedral_surface& surface,
+                   auto weight,
+                   vector<Eigen::Triplet<real>>& entries) {
+  for (size_t f = 0; f < surface.faces.size(); ++f) {
+    const auto& face = surface.faces[f];
+    for (int i = 0; i < 3; ++i) {
+      const auto j = face[(i + 1) % 3];
+      const auto k = face[(i + 2) % 3];
+      const real w = weight(f, i);
+      entries.emplace_back(j, k, -w);
+      entries.emplace_back(k, j, -w);
+      entries.emplace_back(j, j, w);
+      entries.emplace_back(k, k, w);
+    }
+  }
+}
+
+// Heat flow 'M + t L' for the given masses and weights of 't L'.
+// Vertices without mass do not take part in the heat flow.
+// Their unit diagonal keeps the matrix positive definite.
+//
+template <typename real>
+auto heat_flow_matrix(const polyhedral_surface& surface,
+                      auto weight,
+                      span<const real> masses) {
+  const auto n = surface.vertices.size();
+  vector<Eigen::Triplet<real>> entries{};
+  entries.reserve(12 * surface.faces.size() + n);
+  add_laplacian<real>(surface, weight, entries);
+  for (size_t i = 0; i < n; ++i)
+    entries.emplace_back(i, i, (masses[i] > 0) ? masses[i] : real(1));
+  Eigen::SparseMatrix<real> result(n, n);
+  result.setFromTriplets(begin(entries), end(entries));
+  return result;
+}
+
+// Distances are only defined up to a constant on every component.
+// Fixing one of their vertices makes the Laplacian positive definite.
+//
+template <typename real>
+auto poisson_matrix(const polyhedral_surface& surface,
+                    auto weight,
+                    span<const vertex_id> fixed_vertices) {
+  const auto n = surface.vertices.size();
+  vector<Eigen::Triplet<real>> entries{};
+  entries.reserve(12 * surface.faces.size());
+  add_laplacian<real>(surface, weight, entries);
+  vector<bool> fixed(n);
+  for (auto i : fixed_vertices) fixed[i] = true;
+  erase_if(entries, [&](const auto& x) {
+    return fixed[x.row()] || fixed[x.col()];
+  });
+  for (auto i : fixed_vertices) entries.emplace_back(i, i, real(1));
+  Eigen::SparseMatrix<real> result(n, n);
+  result.setFromTriplets(begin(entries), end(entries));
+  return result;
+}
+
+// The smallest vertex of every connected component.
+// Vertices without faces are components of their own.
+//
+auto component_representatives(const polyhedral_surface& surface) {
+  vector<vertex_id> parents(surface.vertices.size());
+  iota(begin(parents), end(parents), 0);
+  const auto find = [&](vertex_id x) {
+    while (parents[x] != x) x = parents[x] = parents[parents[x]];
+    return x;
+  };
+  // Roots are always the smallest vertex of their set.
+  for (const auto& face : surface.faces) {
+    for (int i = 1; i < 3; ++i) {
+      const auto x = find(face[0]);
+      const auto y = find(face[i]);
+      parents[std::max(x, y)] = std::min(x, y);
+    }
+  }
+  vector<vertex_id> result{};
+  for (vertex_id i = 0; i < parents.size(); ++i)
+    if (find(i) == i) result.push_back(i);
+  return result;
+}
+
+// The gradient of the heat in a face is the sum of the rotated edges
+// weighted by the heat of their opposite vertices.
+// Its scale does not matter as only its direction is used.
+//
+auto rotated_edges(const polyhedral_surface& surface, size_t f) noexcept {
+  const auto p = positions_of(surface, surface.faces[f]);
+  const auto normal = cross(p[1] - p[0], p[2] - p[0]);
+  return array<dvec3, 3>{cross(normal, p[2] - p[1]),
+                         cross(normal, p[0] - p[2]),
+                         cross(normal, p[1] - p[0])};
+}
+
+// Normalized negative gradient of the heat in a face
+//
+template <typename real>
+auto heat_direction(const array<dvec3, 3>& edges,
+                    const float64* heat,
+                    const polyhedral_surface::face& face) noexcept {
+  const auto gradient = heat[face[0]] * edges[0] + heat[face[1]] * edges[1] +
+                        heat[face[2]] * edges[2];
+  const auto l = length(gradient);
+  return (l > 0) ? vector3<real>(-gradient / l) : vector3<real>{0};
+}
+
+// The distances solve 'L d = -div X' for the unit vector field 'X'.
+// The negative divergence of 'X' at the corner 'i' of a face
+// is the negative dot product of its direction in the face
+// with the returned weight 'i'.
+//
+template <typename real>
+auto divergence_weights(const basic_heat_method<real>& method,
+                        const polyhedral_surface& surface,
+                        size_t f) noexcept {
+  const auto p = positions_of<real>(surface, surface.faces[f]);
+  const auto& cotangents = method.cotangents[f];
+  array<vector3<real>, 3> result{};
+  for (int i = 0; i < 3; ++i) {
+    const auto j = (i + 1) % 3;
+    const auto k = (i + 2) % 3;
+    result[i] = real(0.5) * (cotangents[k] * (p[j] - p[i]) +
+                             cotangents[j] * (p[k] - p[i]));
+  }
+  return result;
+}
+
+// Distances are shifted such that their mean at the sources is zero.
+//
+template <typename real>
+void shift_to_sources(span<real> distances, span<const vertex_id> sources) {
+  if (sources.empty()) return;
+  float64 shift = 0;
+  for (auto s : sources) shift += distances[s];
+  shift /= sources.size();
+  for (auto& d : distances) d -= shift;
+}
+
+}  // namespace
+
+auto heat_time_step(const polyhedral_surface& surface) -> float64 {
+  if (surface.faces.empty()) return 0;
+  float64 sum = 0;
+  for (const auto& face : surface.faces) {
+    const auto p = positions_of(surface, face);
+    sum += distance(p[0], p[1]) + distance(p[1], p[2]) + distance(p[2], p[0]);
+  }
+  const auto mean = sum / (3 * surface.faces.size());
+  return mean * mean;
+}
+
+auto heat_analysis_from(const polyhedral_surface& surface) -> heat_analysis {
+  // Only the patterns matter. So, all weights are set to one.
+  const auto one = [](auto...) { return 1.0; };
+  const vector<float64> masses(surface.vertices.size(), 1.0);
+  heat_analysis result{};
+  result.heat_flow = cholesky_analysis_from(
+      heat_flow_matrix<float64>(surface, one, masses));
+  result.fixed_vertices = component_representatives(surface);
+  result.poisson = cholesky_analysis_from(
+      poisson_matrix<float64>(surface, one, result.fixed_vertices));
+  return result;
+}
+
+template <typename real>
+auto heat_method_from(const polyhedral_surface& surface,
+                      float64 time_step,
+                      heat_analysis analysis) -> basic_heat_method<real> {
+  const auto n = surface.vertices.size();
+  basic_heat_method<real> result{.time_step = time_step,
+                                 .analysis = std::move(analysis)};
+
+  result.cotangents.resize(surface.faces.size());
+  parallel_for(0, surface.faces.size(), [&](size_t f) {
+    const auto c = cotangents_of(positions_of(surface, surface.faces[f]));
+    result.cotangents[f] = {real(c[0]), real(c[1]), real(c[2])};
+  });
+  vector<float64> masses(n, 0.0);
+  for (const auto& face : surface.faces) {
+    const auto p = positions_of(surface, face);
+    const auto mass = length(cross(p[1] - p[0], p[2] - p[0])) / 6;
+    for (auto i : face) masses[i] += mass;
+  }
+  result.masses.assign(begin(masses), end(masses));
+
+  const auto weight = [&](float64 scale) {
+    return [&result, scale](size_t f, int i) {
+      return 0.5 * scale * result.cotangents[f][i];
+    };
+  };
+  result.heat_flow = cholesky_factor_from(
+      result.analysis.heat_flow,
+      heat_flow_matrix<float64>(surface, weight(time_step), masses));
+  result.poisson = cholesky_factor_from(
+      result.analysis.poisson,
+      poisson_matrix<real>(surface, weight(1.0),
+                           result.analysis.fixed_vertices));
+  return result;
+}
+
+template <typename real>
+void add_heat_sources(const basic_heat_method<real>& method,
+                      heat_field& field,
+                      span<const vertex_id> sources) {
+  const auto n = method.analysis.heat_flow.size();
+  if (field.heat.empty()) {
+    field.heat.assign(n, 0.0);
+    field.is_source.assign(n, false);
+  }
+
+  vector<float64> heat(n);
+  bool changed = false;
+  for (auto s : sources) {
+    if (field.is_source[s]) continue;
+    field.is_source[s] = true;
+    field.sources.push_back(s);
+    heat[s] = 1;
+    changed = true;
+  }
+  if (!changed) return;
+  solve(method.analysis.heat_flow, method.heat_flow, span{heat});
+  for (size_t i = 0; i < n; ++i) field.heat[i] += heat[i];
+}
+
+template <typename real>
+auto geodesic_distances(const basic_heat_method<real>& method,
+                        const polyhedral_surface& surface,
+                        const heat_field& field) -> vector<real> {
+  const auto n = surface.vertices.size();
+  const auto& heat = field.heat;
+  const auto& sources = field.sources;
+  if (heat.empty()) return vector<real>(n);
+
+  vector<vector3<real>> directions(surface.faces.size());
+  parallel_for(0, surface.faces.size(), [&](size_t f) {
+    directions[f] = heat_direction<real>(rotated_edges(surface, f),
+                                         heat.data(), surface.faces[f]);
+  });
+  vector<real> distances(n);
+  for (size_t f = 0; f < surface.faces.size(); ++f) {
+    const auto& face = surface.faces[f];
+    const auto weights = divergence_weights(method, surface, f);
+    for (int i = 0; i < 3; ++i)
+      distances[face[i]] -= dot(weights[i], directions[f]);
+  }
+  for (auto i : method.analysis.fixed_vertices) distances[i] = 0;
+  solve(method.analysis.poisson, method.poisson, span{distances});
+  shift_to_sources(span{distances}, span{sources});
+  return distances;
+}
+
+template <typename real>
+auto geodesic_distances(const basic_heat_method<real>& method,
+                        const polyhedral_surface& surface,
+                        span<const vertex_id> sources) -> vector<real> {
+  heat_field field{};
+  add_heat_sources(method, field, sources);
+  return geodesic_distances(method, surface, field);
+}
+
+template <typename real>
+auto geodesic_distance_matrix(const basic_heat_method<real>& method,
+                              const polyhedral_surface& surface,
+                              span<const vector<vertex_id>> source_sets)
+    -> vector<real> {
+  const auto n = surface.vertices.size();
+  for (const auto& sources : source_sets)
+    for (auto s : sources)
+      if (s >= n)
+        throw runtime_error(
+            "Failed to compute geodesic distance matrix. Source vertex "s +
+            to_string(s) + " is out of range.");
+  vector<real> result(n * source_sets.size());
+  if (source_sets.empty()) return result;
+
+  // Every thread solves blocks of consecutive columns.
+  // Wider blocks make the dense kernels of the solves more efficient
+  // but the heat of a block has to fit into memory for every thread.
+  // So, blocks are only as wide as needed to give every thread one block.
+  constexpr size_t max_block_size = 16;
+  const auto threads = thread_count();
+  const auto block_size =
+      std::min((source_sets.size() + threads - 1) / threads, max_block_size);
+  const auto blocks = (source_sets.size() + block_size - 1) / block_size;
+  parallel_for(
+      0, blocks,
+      [&](size_t b) {
+        const auto first = b * block_size;
+        const auto count = std::min(block_size, source_sets.size() - first);
+
+        vector<float64> heat(n * count);
+        for (size_t j = 0; j < count; ++j)
+          for (auto s : source_sets[first + j]) heat[j * n + s] = 1;
+        solve(method.analysis.heat_flow, method.heat_flow, span{heat}, count);
+
+        // The operators of every face are shared by all columns.
+        const auto distances = span{result}.subspan(first * n, count * n);
+        for (size_t f = 0; f < surface.faces.size(); ++f) {
+          const auto& face = surface.faces[f];
+          const auto edges = rotated_edges(surface, f);
+          const auto weights = divergence_weights(method, surface, f);
+          for (size_t j = 0; j < count; ++j) {
+            const auto x =
+                heat_direction<real>(edges, heat.data() + j * n, face);
+            const auto column = distances.data() + j * n;
+            for (int i = 0; i < 3; ++i)
+              column[face[i]] -= dot(weights[i], x);
+          }
+        }
+        for (size_t j = 0; j < count; ++j)
+          for (auto i : method.analysis.fixed_vertices)
+            distances[j * n + i] = 0;
+        solve(method.analysis.poisson, method.poisson, distances, count);
+
+        for (size_t j = 0; j < count; ++j)
+          shift_to_sources(distances.subspan(j * n, n),
+                           span{source_sets[first + j]});
+      },
+      1);
+  return result;
+}
+
+template auto heat_method_from(const polyhedral_surface&,
+                               float64,
+                               heat_analysis) -> basic_heat_method<float32>;
+template auto heat_method_from(const polyhedral_surface&,
+                               float64,
+                               heat_analysis) -> basic_heat_method<float64>;
+template void add_heat_sources(const basic_heat_method<float32>&,
+                               heat_field&,
+                               span<const vertex_id>);
+template void add_heat_sources(const basic_heat_method<float64>&,
+                               heat_field&,
+                               span<const vertex_id>);
+template auto geodesic_distances(const basic_heat_method<float32>&,
+                                 const polyhedral_surface&,
+                                 const heat_field&) -> vector<float32>;
+template auto geodesic_distances(const basic_heat_method<float64>&,
+                                 const polyhedral_surface&,
+                                 const heat_field&) -> vector<float64>;
+template auto geodesic_distances(const basic_heat_method<float32>&,
+                                 const polyhedral_surface&,
+                                 span<const vertex_id>) -> vector<float32>;
+template auto geodesic_distances(const basic_heat_method<float64>&,
+                                 const polyhedral_surface&,
+                                 span<const vertex_id>) -> vector<float64>;
+template auto geodesic_distance_matrix(const basic_heat_method<float32>&,
+                                       const polyhedral_surface&,
+                                       span<const vector<vertex_id>>)
+    -> vector<float32>;
+template auto geodesic_distance_matrix(const basic_heat_method<float64>&,
+                                       const polyhedral_surface&,
+                                       span<const vector<vertex_id>>)
+    -> vector<float64>;
+
+}  // namespace hyperreflex
@@ -0,0 +1,135 @@
+#pragma once
+#include <hyperreflex/polyhedral_surface.hpp>
+#include <hyperreflex/sparse_cholesky.hpp>
+
+namespace hyperreflex {
+
+/// Symbolic analysis of the heat method which only depends
+/// on the faces of a surface but not on its vertex positions.
+/// So, it can be reused when only positions change.
+///
+struct heat_analysis {
+  cholesky_analysis heat_flow{};
+  cholesky_analysis poisson{};
+  // One vertex of every connected component is fixed to zero
+  // in the Poisson problem.
+  vector<polyhedral_surface::vertex_id> fixed_vertices{};
+};
+
+/// Analyze the sparsity patterns of both linear systems of the heat method.
+///
+auto heat_analysis_from(const polyhedral_surface& surface) -> heat_analysis;
+
+/// Precomputed data of the heat method for geodesic distances
+/// by Crane, Weischedel, and Wardetzky (2013).
+/// Heat flows from the sources for a short time.
+/// The normalized negative gradient of the heat is then integrated
+/// by a Poisson problem to get the distances.
+/// Both linear systems only depend on the surface and the time step.
+/// So, their factorizations are computed once and reused by every solve.
+/// The Poisson problem and the face data use the given scalar type
+/// which is single precision for the viewer.
+///
+template <typename real>
+struct basic_heat_method {
+  using real_type = real;
+
+  float64 time_step{};
+  // Lumped mass of every vertex which is a third of its adjacent faces' area
+  vector<real> masses{};
+  // Cotangents of the angles at the three corners of every face.
+  // They define the cotangent Laplacian and the divergence.
+  vector<array<real, 3>> cotangents{};
+  heat_analysis analysis{};
+  // Factorization of the heat flow 'M + t L' with the mass matrix 'M'
+  // and the positive semi-definite cotangent Laplacian 'L'.
+  // Heat decays exponentially with the distance to its sources.
+  // Far away, it and the factor's entries between distant vertices
+  // are only representable in double precision.
+  cholesky_factor<float64> heat_flow{};
+  // Factorization of the Poisson problem 'L'
+  // with the fixed vertices of the analysis
+  cholesky_factor<real> poisson{};
+};
+
+using heat_method = basic_heat_method<float32>;
+
+/// Time step of the heat flow suggested by Crane et al.
+/// which is the squared mean edge length.
+///
+auto heat_time_step(const polyhedral_surface& surface) -> float64;
+
+/// Compute the operators of the heat method and factorize them
+/// by reusing the symbolic analysis of a surface with the same faces.
+///
+template <typename real>
+auto heat_method_from(const polyhedral_surface& surface,
+                      float64 time_step,
+                      heat_analysis analysis) -> basic_heat_method<real>;
+
+/// Compute the operators of the heat method and factorize them.
+///
+template <typename real = float32>
+auto heat_method_from(const polyhedral_surface& surface, float64 time_step)
+    -> basic_heat_method<real> {
+  return heat_method_from<real>(surface, time_step,
+                                heat_analysis_from(surface));
+}
+
+/// Heat after the flow from a set of sources.
+/// The heat flow is linear in its sources.
+/// So, sources can be added incrementally
+/// by diffusing only the new ones and adding their heat.
+///
+struct heat_field {
+  // Heat of every vertex
+  vector<float64> heat{};
+  // Sources in the order they have been added without duplicates
+  vector<polyhedral_surface::vertex_id> sources{};
+  vector<bool> is_source{};
+};
+
+/// Add the heat of all given sources that are not part of the field yet.
+///
+template <typename real>
+void add_heat_sources(const basic_heat_method<real>& method,
+                      heat_field& field,
+                      span<const polyhedral_surface::vertex_id> sources);
+
+/// Approximate geodesic distances of all vertices
+/// to the sources of the given heat field.
+/// The surface has to be the one the heat method has been computed for.
+/// Distances are shifted such that their mean at the sources is zero.
+///
+template <typename real>
+auto geodesic_distances(const basic_heat_method<real>& method,
+                        const polyhedral_surface& surface,
+                        const heat_field& field) -> vector<real>;
+
+/// Approximate geodesic distances of all vertices to the given sources.
+/// The surface has to be the one the heat method has been computed for.
+/// Distances are shifted such that their mean at the sources is zero.
+///
+template <typename real>
+auto geodesic_distances(const basic_heat_method<real>& method,
+                        const polyhedral_surface& surface,
+                        span<const polyhedral_surface::vertex_id> sources)
+    -> vector<real>;
+
+/// Approximate geodesic distances of all vertices to many sets of sources.
+/// The sets are solved in blocks of columns against the shared factorizations
+/// and the blocks are distributed over all threads.
+/// Blocks have at most 16 columns and are narrower if there are
+/// not enough sets to give every thread its own block.
+/// An exception is thrown if a source is no vertex of the surface.
+/// The result is a column-major matrix with a column for every set.
+/// So, the distances to set 'i' are '[i n, (i + 1) n)' for 'n' vertices.
+///
+template <typename real>
+auto geodesic_distance_matrix(
+    const basic_heat_method<real>& method,
+    const polyhedral_surface& surface,
+    span<const vector<polyhedral_surface::vertex_id>> source_sets)
+    -> vector<real>;
+
+}  // namespace hyperreflex
@@ -0,0 +1,189 @@
+#include <hyperreflex/kd_tree.hpp>
+#include <hyperreflex/parallel.hpp>
+
+namespace hyperreflex {
+
+namespace {
+
+using size_type = kd_tree::size_type;
+
+class kd_tree_builder {
+ public:
+  // Ranges of at least this size are split by concurrent tasks.
+  static constexpr size_t parallel_threshold = size_t{1} << 14;
+
+  kd_tree_builder(span<const polyhedral_surface::vertex> vertices,
+                  kd_tree& tree) noexcept
+      : vertices{vertices}, tree{tree} {
+    // Spawn new tasks only for the top levels of the tree.
+    while ((size_t{1} << task_depth) < 4 * thread_count()) ++task_depth;
+  }
+
+  void build() {
+    tree.ids.resize(vertices.size());
+    iota(tree.ids.begin(), tree.ids.end(), 0);
+    tree.axes.assign(vertices.size(), 0);
+    build(0, vertices.size(), 0);
+  }
+
+ private:
+  void build(size_t first, size_t last, size_t depth) {
+    const auto n = last - first;
+    if (n <= kd_tree::leaf_size) return;
+
+    // The range is split along the longest axis of its bounding box.
+    auto box = aabb3{vertices[tree.ids[first]].position};
+    for (auto i = first + 1; i < last; ++i)
+      box = aabb(box, vertices[tree.ids[i]].position);
+    const auto extent = box._max - box._min;
+    const uint8 axis = (extent.x >= extent.y)
+                           ? ((extent.x >= extent.z) ? 0 : 2)
+                           : ((extent.y >= extent.z) ? 1 : 2);
+
+    const auto mid = first + n / 2;
+    const auto ids = tree.ids.begin();
+    nth_element(ids + first, ids + mid, ids + last,
+                [&](auto i, auto j) {
+                  return vertices[i].position[axis] <
+                         vertices[j].position[axis];
+                });
+    tree.axes[mid] = axis;
+
+    const auto left = [&] { build(first, mid, depth + 1); };
+    const auto right = [&] { build(mid + 1, last, depth + 1); };
+    if ((n >= parallel_threshold) && (depth < task_depth)) {
+      auto task = async(launch::async, left);
+      right();
+      task.get();
+    } else {
+      left();
+      right();
+    }
+  }
+
+  span<const polyhedral_surface::vertex> vertices;
+  kd_tree& tree;
+  size_t task_depth = 0;
+};
+
+// Closer neighbors and, for equal distances, smaller indices come first.
+//
+constexpr auto closer(const vertex_neighbor& x,
+                      const vertex_neighbor& y) noexcept {
+  return (x.squared_distance < y.squared_distance) ||
+         ((x.squared_distance == y.squared_distance) && (x.id < y.id));
+}
+
+// Depth-first search that visits the side of the query point first.
+// The other side is only visited if the squared distance to its cell
+// is not larger than 'bound()'. This distance is updated incrementally
+// by the offsets of the query point to the cell along all axes.
+// A small tolerance keeps vertices whose rounded distance
+// would equal the bound although their cell seems to be farther.
+//
+constexpr float32 slack = 1.0f + 1e-5f;
+
+void search(const vec3& p,
+            const kd_tree& tree,
+            size_t first,
+            size_t last,
+            float32 cell_distance,
+            vec3& offsets,
+            auto&& bound,
+            auto&& visit) {
+  const auto test = [&](size_t i) {
+    visit(vertex_neighbor{tree.ids[i], distance2(p, tree.points[i])});
+  };
+
+  const auto n = last - first;
+  if (n <= kd_tree::leaf_size) {
+    for (auto i = first; i < last; ++i) test(i);
+    return;
+  }
+
+  const auto mid = first + n / 2;
+  test(mid);
+  const auto axis = tree.axes[mid];
+  const auto d = p[axis] - tree.points[mid][axis];
+  const auto near_first = (d < 0) ? first : mid + 1;
+  const auto near_last = (d < 0) ? mid : last;
+  const auto far_first = (d < 0) ? mid + 1 : first;
+  const auto far_last = (d < 0) ? last : mid;
+
+  search(p, tree, near_first, near_last, cell_distance, offsets, bound,
+         visit);
+
+  const auto offset = offsets[axis];
+  const auto far_distance = cell_distance - offset * offset + d * d;
+  if (far_distance > bound() * slack) return;
+  offsets[axis] = d;
+  search(p, tree, far_first, far_last, far_distance, offsets, bound, visit);
+  offsets[axis] = offset;
+}
+
+void search(const vec3& p,
+            const kd_tree& tree,
+            auto&& bound,
+            auto&& visit) {
+  vec3 offsets{0.0f};
+  search(p, tree, 0, tree.size(), 0.0f, offsets, bound, visit);
+}
+
+}  // namespace
+
+auto kd_tree_from(span<const polyhedral_surface::vertex> vertices) -> kd_tree {
+  kd_tree tree{};
+  if (vertices.empty()) return tree;
+  kd_tree_builder{vertices, tree}.build();
+  tree.points.resize(vertices.size());
+  parallel_for(0, vertices.size(), [&](size_t i) {
+    tree.points[i] = vertices[tree.ids[i]].position;
+  });
+  return tree;
+}
+
+auto nearest(const vec3& p, const kd_tree& tree) noexcept -> vertex_neighbor {
+  vertex_neighbor result{};
+  search(
+      p, tree, [&] { return result.squared_distance; },
+      [&](const vertex_neighbor& x) {
+        if (closer(x, result)) result = x;
+      });
+  return result;
+}
+
+auto k_nearest(const vec3& p, const kd_tree& tree, size_t k)
+    -> vector<vertex_neighbor> {
+  // The farthest of the current candidates is on top of the heap.
+  vector<vertex_neighbor> heap{};
+  if (k == 0) return heap;
+  heap.reserve(k);
+  search(
+      p, tree,
+      [&] {
+        return (heap.size() < k) ? infinity : heap.front().squared_distance;
+      },
+      [&](const vertex_neighbor& x) {
+        if (heap.size() < k) {
+          heap.push_back(x);
+          push_heap(heap.begin(), heap.end(), closer);
+        } else if (closer(x, heap.front())) {
+          pop_heap(heap.begin(), heap.end(), closer);
+          heap.back() = x;
+          push_heap(heap.begin(), heap.end(), closer);
+        }
+      });
+  sort_heap(heap.begin(), heap.end(), closer);
+  return heap;
+}
+
+void nearest(const kd_tree& tree,
+             span<const vec3> points,
+             span<vertex_neighbor> results) {
+  assert(points.size() == results.size());
+  parallel_for(
+      0, points.size(),
+      [&](size_t i) { results[i] = nearest(points[i], tree); }, 1 << 8);
+}
+
+}  // namespace hyperreflex
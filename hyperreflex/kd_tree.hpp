@@ -0,0 +1,58 @@
+#pragma once
+#include <hyperreflex/polyhedral_surface.hpp>
+
+namespace hyperreflex {
+
+/// Balanced kd-tree over the vertices of a polyhedral surface.
+/// The tree is stored implicitly in the order of its points.
+/// Every range '[first, last)' with more than 'leaf_size' points
+/// is split at its median 'first + (last - first) / 2'
+/// which is part of neither of the two subranges.
+///
+struct kd_tree {
+  using size_type = uint32;
+
+  static constexpr size_type leaf_size = 8;
+
+  auto empty() const noexcept { return points.empty(); }
+  auto size() const noexcept { return points.size(); }
+
+  // Positions in tree order
+  vector<vec3> points{};
+  // Vertex indices in tree order
+  vector<polyhedral_surface::vertex_id> ids{};
+  // Split axis of every median
+  vector<uint8> axes{};
+};
+
+/// Vertex found by a nearest-neighbor query.
+/// Among vertices with equal distance, the one with the smallest index wins.
+///
+struct vertex_neighbor {
+  operator bool() const noexcept { return id != polyhedral_surface::invalid; }
+
+  polyhedral_surface::vertex_id id = polyhedral_surface::invalid;
+  float32 squared_distance = infinity;
+};
+
+/// Build a kd-tree over the given vertex positions in parallel.
+///
+auto kd_tree_from(span<const polyhedral_surface::vertex> vertices) -> kd_tree;
+
+/// Nearest vertex of the given point.
+///
+auto nearest(const vec3& p, const kd_tree& tree) noexcept -> vertex_neighbor;
+
+/// The 'k' nearest vertices of the given point sorted by their distance.
+/// Fewer vertices are returned if the tree does not contain enough of them.
+///
+auto k_nearest(const vec3& p, const kd_tree& tree, size_t k)
+    -> vector<vertex_neighbor>;
+
+/// Nearest vertices of many points at once computed by all threads.
+///
+void nearest(const kd_tree& tree,
+             span<const vec3> points,
+             span<vertex_neighbor> results);
+
+}  // namespace hyperreflex
@@ -0,0 +1,187 @@
+#include <hyperreflex/local_heat_method.hpp>
+
+namespace hyperreflex {
+
+namespace {
+
+using vertex_id = polyhedral_surface::vertex_id;
+
+// Sorted vertices whose distance to the sources along the edges
+// is at most the given radius by Dijkstra's algorithm.
+// Edge paths are never shorter than geodesics.
+// So, the band contains all vertices that are geodesically closer.
+// Only vertices of the band are visited.
+//
+auto band_from(const polyhedral_surface& surface,
+               const vertex_adjacency& adjacency,
+               span<const vertex_id> sources,
+               float64 radius) {
+  using entry = pair<float64, vertex_id>;
+  unordered_map<vertex_id, float64> distances{};
+  priority_queue<entry, vector<entry>, greater<>> queue{};
+  for (auto s : sources) {
+    distances[s] = 0;
+    queue.emplace(0, s);
+  }
+  vector<vertex_id> result{};
+  while (!queue.empty()) {
+    const auto [d, vid] = queue.top();
+    queue.pop();
+    if (d > distances[vid]) continue;
+    result.push_back(vid);
+    const auto p = dvec3(surface.vertices[vid].position);
+    for (auto neighbor : adjacency(vid)) {
+      const auto q = dvec3(surface.vertices[neighbor].position);
+      const auto x = d + distance(p, q);
+      if (x > radius) continue;
+      const auto [it, inserted] = distances.try_emplace(neighbor, x);
+      if (!inserted && (it->second <= x)) continue;
+      it->second = x;
+      queue.emplace(x, neighbor);
+    }
+  }
+  ranges::sort(result);
+  return result;
+}
+
+// Surface of all faces whose vertices are part of the band.
+// Vertex 'i' of the submesh is vertex 'band[i]' of the surface
+// and 'local' maps the vertices of the band back to the submesh.
+//
+struct submesh {
+  polyhedral_surface surface{};
+  unordered_map<vertex_id, vertex_id> local{};
+};
+
+auto submesh_from(const polyhedral_surface& surface,
+                  const vertex_faces& incidence,
+                  span<const vertex_id> band) {
+  submesh result{};
+  result.local.reserve(band.size());
+  result.surface.vertices.reserve(band.size());
+  for (auto vid : band) {
+    result.local.emplace(vid, result.surface.vertices.size());
+    result.surface.vertices.push_back(surface.vertices[vid]);
+  }
+  // Every face is found at each of its vertices
+  // and only added at its smallest one.
+  // Degenerate faces appear more than once around the same vertex.
+  //
+  for (auto vid : band) {
+    const auto faces = incidence(vid);
+    for (size_t k = 0; k < faces.size(); ++k) {
+      if ((k > 0) && (faces[k] == faces[k - 1])) continue;
+      const auto& face = surface.faces[faces[k]];
+      if (ranges::min(face) != vid) continue;
+      polyhedral_surface::face f{};
+      bool inside = true;
+      for (int i = 0; inside && (i < 3); ++i) {
+        const auto it = result.local.find(face[i]);
+        inside = (it != result.local.end());
+        if (inside) f[i] = it->second;
+      }
+      if (inside) result.surface.faces.push_back(f);
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+template <typename real>
+auto local_geodesic_distances(const polyhedral_surface& surface,
+                              const vertex_adjacency& adjacency,
+                              const vertex_faces& incidence,
+                              float64 time_step,
+                              span<const vertex_id> sources,
+                              float64 radius)
+    -> optional<local_distances<real>> {
+  const auto n = surface.vertices.size();
+  local_distances<real> result{};
+  if (sources.empty()) return result;
+
+  // Edge paths may be longer than geodesics
+  // and the boundary should be far enough from the radius.
+  // Also, heat needs a few edges to flow even for tiny radii.
+  const auto margin = 4 * sqrt(time_step);
+  for (float64 padding = 1.5;; padding *= 2) {
+    const auto band =
+        band_from(surface, adjacency, sources, padding * radius + margin);
+    if (2 * band.size() > n) return nullopt;
+    const auto sub = submesh_from(surface, incidence, band);
+    vector<vertex_id> local_sources(sources.size());
+    for (size_t i = 0; i < sources.size(); ++i)
+      local_sources[i] = sub.local.at(sources[i]);
+    const auto distances = geodesic_distances(
+        heat_method_from<real>(sub.surface, time_step), sub.surface,
+        span<const vertex_id>{local_sources});
+
+    // Vertices of the band with neighbors outside of it lie on its boundary.
+    // If the band has no boundary, it contains all reachable vertices.
+    const auto too_narrow = [&] {
+      for (size_t i = 0; i < band.size(); ++i) {
+        if (distances[i] >= radius) continue;
+        for (auto neighbor : adjacency(band[i]))
+          if (!sub.local.contains(neighbor)) return true;
+      }
+      return false;
+    };
+    if (too_narrow()) continue;
+
+    for (size_t i = 0; i < band.size(); ++i) {
+      if (distances[i] > radius) continue;
+      result.vertices.push_back(band[i]);
+      result.distances.push_back(distances[i]);
+    }
+    return result;
+  }
+}
+
+template <typename real>
+auto local_geodesic_distances(const basic_heat_method<real>& method,
+                              const polyhedral_surface& surface,
+                              const vertex_adjacency& adjacency,
+                              const vertex_faces& incidence,
+                              span<const vertex_id> sources,
+                              float64 radius) -> vector<real> {
+  if (const auto local = local_geodesic_distances<real>(
+          surface, adjacency, incidence, method.time_step, sources, radius)) {
+    vector<real> result(surface.vertices.size(), infinity);
+    for (size_t i = 0; i < local->vertices.size(); ++i)
+      result[local->vertices[i]] = local->distances[i];
+    return result;
+  }
+  auto result = geodesic_distances(method, surface, sources);
+  for (auto& d : result)
+    if (d > radius) d = infinity;
+  return result;
+}
+
+template auto local_geodesic_distances(const polyhedral_surface&,
+                                       const vertex_adjacency&,
+                                       const vertex_faces&,
+                                       float64,
+                                       span<const vertex_id>,
+                                       float64)
+    -> optional<local_distances<float32>>;
+template auto local_geodesic_distances(const polyhedral_surface&,
+                                       const vertex_adjacency&,
+                                       const vertex_faces&,
+                                       float64,
+                                       span<const vertex_id>,
+                                       float64)
+    -> optional<local_distances<float64>>;
+template auto local_geodesic_distances(const basic_heat_method<float32>&,
+                                       const polyhedral_surface&,
+                                       const vertex_adjacency&,
+                                       const vertex_faces&,
+                                       span<const vertex_id>,
+                                       float64) -> vector<float32>;
+template auto local_geodesic_distances(const basic_heat_method<float64>&,
+                                       const polyhedral_surface&,
+                                       const vertex_adjacency&,
+                                       const vertex_faces&,
+                                       span<const vertex_id>,
+                                       float64) -> vector<float64>;
+
+}  // namespace hyperreflex
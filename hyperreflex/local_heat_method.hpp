@@ -0,0 +1,55 @@
+#pragma once
+#include <hyperreflex/adjacency.hpp>
+#include <hyperreflex/heat_method.hpp>
+
+namespace hyperreflex {
+
+/// Sparse geodesic distances of all vertices up to a given radius
+///
+template <typename real>
+struct local_distances {
+  // Sorted vertices whose distance is at most the radius
+  vector<polyhedral_surface::vertex_id> vertices{};
+  // Distance of every vertex above
+  vector<real> distances{};
+};
+
+/// Approximate geodesic distances of all vertices up to a given radius
+/// by the heat method restricted to a band around the sources.
+/// The band is flooded along the edges and its submesh is gathered
+/// from the faces around its vertices, factorized, and solved on its own.
+/// So, the cost depends on the size of the band
+/// instead of the size of the surface.
+/// Heat does not flow over the boundary of the band.
+/// As this distorts the distances close to it,
+/// the band is padded and widened until none of its boundary vertices
+/// is closer to the sources than the radius.
+/// Only vertices within the radius are part of the result.
+/// Returns nothing if the band would contain more than half of the surface
+/// such that solving on the whole surface should be preferred.
+///
+template <typename real>
+auto local_geodesic_distances(
+    const polyhedral_surface& surface,
+    const vertex_adjacency& adjacency,
+    const vertex_faces& incidence,
+    float64 time_step,
+    span<const polyhedral_surface::vertex_id> sources,
+    float64 radius) -> optional<local_distances<real>>;
+
+/// Approximate geodesic distances of all vertices up to a given radius
+/// by the local heat method which falls back to the precomputed heat method
+/// of the whole surface if the band would be too large.
+/// The result is dense and contains the distances of all vertices.
+/// Vertices farther away than the radius get infinite distances.
+///
+template <typename real>
+auto local_geodesic_distances(
+    const basic_heat_method<real>& method,
+    const polyhedral_surface& surface,
+    const vertex_adjacency& adjacency,
+    const vertex_faces& incidence,
+    span<const polyhedral_surface::vertex_id> sources,
+    float64 radius) -> vector<real>;
+
+}  // namespace hyperreflex
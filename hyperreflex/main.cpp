@@ -1,10 +1,134 @@
+#include <hyperreflex/batch.hpp>
+#include <hyperreflex/parallel.hpp>
+#include <hyperreflex/renderer.hpp>
 #include <hyperreflex/viewer.hpp>
+#include <hyperreflex/welding.hpp>
 
 using namespace std;
 
+// Headless mode to load, weld, and validate many mesh files
+// which writes one line of statistics per file to a CSV file.
+//
+int run_batch(const filesystem::path& input,
+              const filesystem::path& output,
+              size_t workers) {
+  const auto files = hyperreflex::batch_files_from(input);
+  fstream csv{output, ios::out | ios::trunc};
+  if (!csv.is_open()) {
+    cerr << "Failed to open CSV file " << output << " for writing.\n";
+    return 1;
+  }
+  csv << hyperreflex::batch_statistics::csv_header << '\n';
+
+  size_t done = 0;
+  size_t failed = 0;
+  const auto start = hyperreflex::clock::now();
+  hyperreflex::batch_process(
+      files, workers, [&](const hyperreflex::batch_statistics& stats) {
+        // Flush every line to keep the results of interrupted jobs.
+        csv << stats << endl;
+        if (!stats.error.empty()) ++failed;
+        cout << '[' << ++done << '/' << files.size() << "] " << stats.path
+             << (stats.error.empty() ? "" : " failed") << '\n';
+      });
+  const auto end = hyperreflex::clock::now();
+
+  cout << "Processed " << files.size() << " files in "
+       << chrono::duration<float>(end - start).count() << " s with " << failed
+       << " failures.\n";
+  return failed ? 1 : 0;
+}
+
+// Headless mode to render an image of a surface on the CPU
+// which needs neither a window nor a GPU.
+//
+int run_render(const filesystem::path& input,
+               const filesystem::path& output,
+               int width,
+               int height) {
+  try {
+    const auto surface =
+        hyperreflex::welded(hyperreflex::polyhedral_surface_from(input));
+    // Huge surfaces are rendered by the compressed BVH to save memory.
+    //
+    const auto compressed = hyperreflex::prefers_compressed_bvh(surface);
+    hyperreflex::bvh tree{};
+    hyperreflex::compressed_bvh compressed_tree{};
+    if (compressed)
+      compressed_tree = hyperreflex::compressed_bvh_from(surface);
+    else
+      tree = hyperreflex::bvh_from(surface);
+    const auto cam = hyperreflex::fitting_camera(
+        hyperreflex::aabb_from(surface), width, height);
+
+    const auto start = hyperreflex::clock::now();
+    const auto image =
+        compressed ? hyperreflex::render(cam, compressed_tree,
+                                         surface.vertices, surface.faces)
+                   : hyperreflex::render(cam, tree, surface.vertices,
+                                         surface.faces);
+    const auto end = hyperreflex::clock::now();
+    hyperreflex::save_image_file(image, output);
+
+    cout << "Rendered " << output << " (" << width << "x" << height
+         << ") in " << chrono::duration<float>(end - start).count()
+         << " s.\n";
+  } catch (exception& e) {
+    cerr << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
+
+// Parse a command-line argument that has to be a positive integer.
+//
+auto positive_integer(const char* str) noexcept -> optional<size_t> {
+  const auto last = str + strlen(str);
+  size_t result;
+  const auto [ptr, error] = from_chars(str, last, result);
+  if ((error != errc{}) || (ptr != last) || (result == 0)) return {};
+  return result;
+}
+
+void print_usage(const char* program) {
+  cout << "Usage:\n"
+       << program << " <STL object file path>\n"
+       << program << " --batch <directory or file list> <CSV file>"
+       << " [<worker count>]\n"
+       << program << " --render <surface file> <PNG or PPM file>"
+       << " [<width> <height>]\n";
+}
+
 int main(int argc, char* argv[]) {
+  if ((argc >= 4) && (argc <= 5) && (argv[1] == "--batch"sv)) {
+    const auto workers = (argc == 5) ? positive_integer(argv[4])
+                                     : hyperreflex::thread_count();
+    if (!workers) {
+      cerr << "The worker count '" << argv[4]
+           << "' is not a positive integer.\n";
+      print_usage(argv[0]);
+      return 1;
+    }
+    return run_batch(argv[2], argv[3], *workers);
+  }
+
+  if (((argc == 4) || (argc == 6)) && (argv[1] == "--render"sv)) {
+    const auto width = (argc == 6) ? positive_integer(argv[4]) : 800;
+    const auto height = (argc == 6) ? positive_integer(argv[5]) : 800;
+    // Larger sizes would overflow the pixel count.
+    constexpr size_t max_size = 1 << 15;
+    if (!width || !height || (*width > max_size) || (*height > max_size)) {
+      cerr << "The image size '" << argv[4] << "x" << argv[5]
+           << "' has to consist of positive integers of at most " << max_size
+           << ".\n";
+      print_usage(argv[0]);
+      return 1;
+    }
+    return run_render(argv[2], argv[3], *width, *height);
+  }
+
   if (argc != 2) {
-    std::cout << "Usage:\n" << argv[0] << " <STL object file path>\n";
+    print_usage(argv[0]);
     return 0;
   }
 
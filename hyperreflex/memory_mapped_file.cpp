@@ -0,0 +1,120 @@
+#include <hyperreflex/memory_mapped_file.hpp>
+//
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace hyperreflex {
+
+#ifdef _WIN32
+
+memory_mapped_file::memory_mapped_file(const filesystem::path& path) {
+  const auto throw_error = [&](czstring str) {
+    throw runtime_error("Failed to map file '"s + path.string() + "'. " + str);
+  };
+
+  // All loaders read the file front to back exactly once.
+  // So, allow the system to read ahead aggressively.
+  //
+  const auto file =
+      ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                    OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    throw_error("The file could not be opened.");
+
+  LARGE_INTEGER size;
+  if (!::GetFileSizeEx(file, &size)) {
+    ::CloseHandle(file);
+    throw_error("The file size could not be determined.");
+  }
+  bytes = size_t(size.QuadPart);
+
+  // Mapping an empty file is not allowed.
+  // An empty view is the correct representation anyway.
+  //
+  if (bytes == 0) {
+    ::CloseHandle(file);
+    return;
+  }
+
+  const auto mapping =
+      ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  // The mapping object keeps its own reference to the file.
+  ::CloseHandle(file);
+  if (!mapping) throw_error("The system call 'CreateFileMapping' failed.");
+
+  const auto ptr = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  // The view stays valid after closing the mapping object.
+  ::CloseHandle(mapping);
+  if (!ptr) throw_error("The system call 'MapViewOfFile' failed.");
+  address = static_cast<const char*>(ptr);
+}
+
+memory_mapped_file::~memory_mapped_file() noexcept {
+  if (address) ::UnmapViewOfFile(address);
+}
+
+#else
+
+memory_mapped_file::memory_mapped_file(const filesystem::path& path) {
+  const auto throw_error = [&](czstring str) {
+    throw runtime_error("Failed to map file '"s + path.string() + "'. " + str);
+  };
+
+  const auto fd = ::open(path.c_str(), O_RDONLY);
+  if (fd == -1) throw_error("The file could not be opened.");
+
+  struct stat info;
+  if (::fstat(fd, &info) == -1) {
+    ::close(fd);
+    throw_error("The file size could not be determined.");
+  }
+  bytes = info.st_size;
+
+  // Mapping an empty file is not allowed.
+  // An empty view is the correct representation anyway.
+  //
+  if (bytes == 0) {
+    ::close(fd);
+    return;
+  }
+
+  const auto ptr = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping stays valid after closing the file descriptor.
+  ::close(fd);
+  if (ptr == MAP_FAILED) throw_error("The system call 'mmap' failed.");
+  address = static_cast<const char*>(ptr);
+
+  // All loaders read the file front to back exactly once.
+  // So, allow the kernel to read ahead aggressively.
+  //
+  ::madvise(ptr, bytes, MADV_SEQUENTIAL);
+}
+
+memory_mapped_file::~memory_mapped_file() noexcept {
+  if (address) ::munmap(const_cast<char*>(address), bytes);
+}
+
+#endif
+
+memory_mapped_file::memory_mapped_file(memory_mapped_file&& x) noexcept
+    : address{x.address}, bytes{x.bytes} {
+  x.address = nullptr;
+  x.bytes = 0;
+}
+
+memory_mapped_file& memory_mapped_file::operator=(
+    memory_mapped_file&& x) noexcept {
+  swap(address, x.address);
+  swap(bytes, x.bytes);
+  return *this;
+}
+
+}  // namespace hyperreflex
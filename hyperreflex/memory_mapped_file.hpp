@@ -0,0 +1,39 @@
+#pragma once
+#include <hyperreflex/utility.hpp>
+
+namespace hyperreflex {
+
+// Read-only view of a whole file mapped into the address space.
+// Large mesh files should not be copied through a stream buffer
+// when their content is only read once in a linear fashion.
+// The type only owns the mapping and is therefore move-only.
+//
+class memory_mapped_file {
+ public:
+  memory_mapped_file() noexcept = default;
+  memory_mapped_file(const filesystem::path& path);
+  ~memory_mapped_file() noexcept;
+
+  // Copying is not allowed.
+  memory_mapped_file(const memory_mapped_file&) = delete;
+  memory_mapped_file& operator=(const memory_mapped_file&) = delete;
+
+  // Moving
+  memory_mapped_file(memory_mapped_file&& x) noexcept;
+  memory_mapped_file& operator=(memory_mapped_file&& x) noexcept;
+
+  auto data() const noexcept -> const char* { return address; }
+  auto size() const noexcept -> size_t { return bytes; }
+  auto empty() const noexcept -> bool { return bytes == 0; }
+
+  auto begin() const noexcept { return address; }
+  auto end() const noexcept { return address + bytes; }
+
+  operator string_view() const noexcept { return {address, bytes}; }
+
+ private:
+  const char* address = nullptr;
+  size_t bytes = 0;
+};
+
+}  // namespace hyperreflex
@@ -0,0 +1,217 @@
+#include <hyperreflex/obj_surface.hpp>
+//
+#include <hyperreflex/memory_mapped_file.hpp>
+#include <hyperreflex/parallel.hpp>
+
+namespace hyperreflex {
+
+namespace {
+
+// Result of parsing a chunk of lines.
+// Positive indices are absolute and can be stored directly.
+// Negative indices are relative to the number of preceding vertices
+// which is only known after all chunks have been parsed.
+// Such corners are fixed afterwards by adding the vertex offset of the chunk.
+//
+struct obj_chunk {
+  struct relative_corner {
+    size_t corner;
+    int64 index;
+  };
+
+  vector<vec3> positions{};
+  vector<polyhedral_surface::face> faces{};
+  vector<relative_corner> relative_corners{};
+  // Error message of the first error in this chunk.
+  // Without an error, all lines of the chunk have been parsed.
+  // Otherwise, the line count stops in front of the erroneous line.
+  string error{};
+  size_t line_count{};
+};
+
+struct obj_line_parser {
+  static constexpr auto blank(char c) noexcept {
+    return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\v') ||
+           (c == '\f');
+  }
+
+  void skip_blanks() noexcept {
+    while ((it != last) && blank(*it)) ++it;
+  }
+
+  auto empty() noexcept {
+    skip_blanks();
+    return it == last;
+  }
+
+  auto word() noexcept -> string_view {
+    skip_blanks();
+    const auto first = it;
+    while ((it != last) && !blank(*it)) ++it;
+    return {first, it};
+  }
+
+  auto number() -> float32 {
+    skip_blanks();
+    if ((it != last) && (*it == '+')) ++it;
+    float32 result;
+    const auto [ptr, error] = from_chars(it, last, result);
+    if (error != errc{}) throw runtime_error("Failed to parse number.");
+    it = ptr;
+    return result;
+  }
+
+  // Parse a face corner given as 'v', 'v/vt', 'v//vn', or 'v/vt/vn'.
+  // Only the position index is of interest.
+  //
+  auto corner() -> int64 {
+    skip_blanks();
+    if ((it != last) && (*it == '+')) ++it;
+    int64 result;
+    const auto [ptr, error] = from_chars(it, last, result);
+    if ((error != errc{}) || (result == 0))
+      throw runtime_error("Failed to parse face index.");
+    it = ptr;
+    while ((it != last) && !blank(*it)) ++it;
+    return result;
+  }
+
+  const char* it;
+  const char* last;
+};
+
+void parse_obj_chunk(const char* first, const char* last, obj_chunk& chunk) {
+  chunk.positions.reserve((last - first) / 64);
+  chunk.faces.reserve((last - first) / 64);
+
+  vector<int64> polygon{};
+  try {
+    for (auto line = first; line < last; ++chunk.line_count) {
+      const auto line_end = find(line, last, '\n');
+      obj_line_parser input{line, line_end};
+      line = line_end + 1;
+
+      const auto keyword = input.word();
+      if (keyword == "v") {
+        vec3 p;
+        p.x = input.number();
+        p.y = input.number();
+        p.z = input.number();
+        chunk.positions.push_back(p);
+      } else if (keyword == "f") {
+        polygon.clear();
+        while (!input.empty()) polygon.push_back(input.corner());
+        if (polygon.size() < 3)
+          throw runtime_error("Faces need at least three corners.");
+
+        // Triangulate the polygon as a fan around its first corner.
+        //
+        const auto vertex_count = int64(chunk.positions.size());
+        for (size_t k = 2; k < polygon.size(); ++k) {
+          const array<int64, 3> indices{polygon[0], polygon[k - 1],
+                                        polygon[k]};
+          polyhedral_surface::face f{};
+          for (size_t j = 0; j < 3; ++j) {
+            if (indices[j] > 0) {
+              if (indices[j] > polyhedral_surface::invalid)
+                throw runtime_error("Face index is out of range.");
+              f[j] = indices[j] - 1;
+              continue;
+            }
+            chunk.relative_corners.push_back(
+                {3 * chunk.faces.size() + j, vertex_count + indices[j]});
+          }
+          chunk.faces.push_back(f);
+        }
+      }
+      // All other statements, such as normals, texture coordinates,
+      // groups, and materials, are ignored.
+    }
+  } catch (const exception& e) {
+    chunk.error = e.what();
+  }
+}
+
+}  // namespace
+
+auto polyhedral_surface_from_obj_file(const filesystem::path& path)
+    -> polyhedral_surface {
+  const auto throw_error = [&](const string& str) {
+    throw runtime_error("Failed to load OBJ file from path '"s +
+                        path.string() + "'. " + str);
+  };
+
+  const memory_mapped_file file{path};
+
+  // Split the file into chunks of roughly the same size.
+  // Every chunk boundary is moved forward to the start of a line.
+  //
+  constexpr size_t min_chunk_size = size_t{1} << 20;
+  const auto chunk_count =
+      std::clamp(file.size() / min_chunk_size, size_t{1}, thread_count());
+  vector<const char*> bounds(chunk_count + 1);
+  bounds.front() = file.begin();
+  bounds.back() = file.end();
+  for (size_t i = 1; i < chunk_count; ++i) {
+    const auto p = std::max(bounds[i - 1],
+                            file.begin() + i * file.size() / chunk_count);
+    bounds[i] = std::min(find(p, file.end(), '\n') + 1, file.end());
+  }
+
+  vector<obj_chunk> chunks(chunk_count);
+  parallel_invoke(chunk_count, [&](size_t i) {
+    parse_obj_chunk(bounds[i], bounds[i + 1], chunks[i]);
+  });
+  // Lines of errors are given relative to their chunk.
+  // Adding the line counts of all preceding chunks makes them absolute.
+  //
+  for (size_t i = 0, line = 1; i < chunk_count; ++i) {
+    line += chunks[i].line_count;
+    if (!chunks[i].error.empty())
+      throw_error("Line "s + to_string(line) + ": " + chunks[i].error);
+  }
+
+  // Join all chunks by using the prefix sums of their sizes.
+  //
+  vector<size_t> vertex_offsets(chunk_count + 1);
+  vector<size_t> face_offsets(chunk_count + 1);
+  for (size_t i = 0; i < chunk_count; ++i) {
+    vertex_offsets[i + 1] = vertex_offsets[i] + chunks[i].positions.size();
+    face_offsets[i + 1] = face_offsets[i] + chunks[i].faces.size();
+  }
+  if (vertex_offsets.back() >= polyhedral_surface::invalid)
+    throw_error("The file contains too many vertices.");
+
+  polyhedral_surface surface{};
+  surface.vertices.resize(vertex_offsets.back());
+  surface.faces.resize(face_offsets.back());
+  atomic<bool> out_of_range = false;
+  parallel_invoke(chunk_count, [&](size_t i) {
+    auto& chunk = chunks[i];
+    for (auto [corner, index] : chunk.relative_corners) {
+      index += vertex_offsets[i];
+      if (index < 0) {
+        out_of_range = true;
+        continue;
+      }
+      chunk.faces[corner / 3][corner % 3] = index;
+    }
+    for (size_t j = 0; j < chunk.positions.size(); ++j)
+      surface.vertices[vertex_offsets[i] + j] = {
+          .position = chunk.positions[j], .normal = {}};
+    for (size_t j = 0; j < chunk.faces.size(); ++j) {
+      const auto& f = chunk.faces[j];
+      for (auto vid : f)
+        if (vid >= surface.vertices.size()) out_of_range = true;
+      surface.faces[face_offsets[i] + j] = f;
+    }
+    // Free the memory of the chunk as early as possible.
+    chunk = {};
+  });
+  if (out_of_range) throw_error("Face indices are out of range.");
+
+  compute_vertex_normals(surface);
+  return surface;
+}
+
+}  // namespace hyperreflex
@@ -0,0 +1,22 @@
+#pragma once
+#include <hyperreflex/polyhedral_surface.hpp>
+
+namespace hyperreflex {
+
+/// Check whether the given path uses the file extension of OBJ files.
+///
+inline auto is_obj_file(const filesystem::path& path) -> bool {
+  return (path.extension().string() == ".obj") ||
+         (path.extension().string() == ".OBJ");
+}
+
+/// Load a polyhedral surface from a Wavefront OBJ file without Assimp.
+/// The file is memory-mapped and parsed in parallel chunks of lines.
+/// Only vertex positions and faces are read.
+/// Polygons are triangulated as fans around their first corner
+/// and vertex normals are computed from area-weighted face normals.
+///
+auto polyhedral_surface_from_obj_file(const filesystem::path& path)
+    -> polyhedral_surface;
+
+}  // namespace hyperreflex
@@ -0,0 +1,94 @@
+#pragma once
+#include <hyperreflex/utility.hpp>
+
+namespace hyperreflex {
+
+/// Upper bound of the threads used by parallel algorithms
+/// that are called from the current thread where zero means no bound.
+///
+inline thread_local size_t thread_limit = 0;
+
+/// Number of threads to be used by the parallel algorithms.
+///
+inline auto thread_count() noexcept -> size_t {
+  const size_t threads = std::max(1u, thread::hardware_concurrency());
+  return thread_limit ? std::min(thread_limit, threads) : threads;
+}
+
+/// Bound the threads of all parallel algorithms called from this thread
+/// as long as the guard exists.
+/// Concurrent workers use this to not spawn threads for every worker
+/// in nested parallel algorithms.
+///
+class thread_limit_guard {
+ public:
+  explicit thread_limit_guard(size_t limit) noexcept
+      : previous{thread_limit} {
+    thread_limit = std::max(limit, size_t{1});
+  }
+  ~thread_limit_guard() noexcept { thread_limit = previous; }
+  thread_limit_guard(const thread_limit_guard&) = delete;
+  thread_limit_guard& operator=(const thread_limit_guard&) = delete;
+
+ private:
+  size_t previous;
+};
+
+/// Call 'function(i)' for all 'i' in '[0, count)' where every call
+/// is run on its own thread and the calling thread takes 'i = 0'.
+/// After all calls have finished, the first exception
+/// with respect to the index order will be rethrown.
+///
+void parallel_invoke(size_t count, auto&& function) {
+  vector<future<void>> tasks{};
+  tasks.reserve(count);
+  for (size_t i = 1; i < count; ++i)
+    tasks.push_back(async(launch::async, [&function, i] { function(i); }));
+
+  exception_ptr error{};
+  try {
+    if (count > 0) function(size_t{0});
+  } catch (...) {
+    error = current_exception();
+  }
+  for (auto& task : tasks) {
+    try {
+      task.get();
+    } catch (...) {
+      if (!error) error = current_exception();
+    }
+  }
+  if (error) rethrow_exception(error);
+}
+
+/// Split '[first, last)' into contiguous blocks of at least 'grain' elements,
+/// one per thread, and call 'function(block_first, block_last)' for each.
+///
+void parallel_for_blocks(size_t first,
+                         size_t last,
+                         auto&& function,
+                         size_t grain = 1 << 12) {
+  if (first >= last) return;
+  const auto size = last - first;
+  const auto blocks =
+      std::clamp(size / std::max(grain, size_t{1}), size_t{1}, thread_count());
+  parallel_invoke(blocks, [&](size_t i) {
+    function(first + i * size / blocks, first + (i + 1) * size / blocks);
+  });
+}
+
+/// Call 'function(i)' for all 'i' in '[first, last)' in parallel.
+///
+void parallel_for(size_t first,
+                  size_t last,
+                  auto&& function,
+                  size_t grain = 1 << 12) {
+  parallel_for_blocks(
+      first, last,
+      [&](size_t block_first, size_t block_last) {
+        for (auto i = block_first; i < block_last; ++i) function(i);
+      },
+      grain);
+}
+
+}  // namespace hyperreflex
@@ -0,0 +1,337 @@
+#include <hyperreflex/ply_surface.hpp>
+//
+#include <hyperreflex/memory_mapped_file.hpp>
+#include <hyperreflex/parallel.hpp>
+
+namespace hyperreflex {
+
+namespace {
+
+static_assert(endian::native == endian::little,
+              "Binary PLY files are read and written in little-endian order.");
+
+// Byte size of a scalar PLY type or zero for unknown types.
+//
+auto ply_scalar_size(string_view type) noexcept -> size_t {
+  if ((type == "char") || (type == "uchar") ||  //
+      (type == "int8") || (type == "uint8"))
+    return 1;
+  if ((type == "short") || (type == "ushort") ||  //
+      (type == "int16") || (type == "uint16"))
+    return 2;
+  if ((type == "int") || (type == "uint") ||  //
+      (type == "int32") || (type == "uint32") ||
+      (type == "float") || (type == "float32"))
+    return 4;
+  if ((type == "double") || (type == "float64")) return 8;
+  return 0;
+}
+
+auto ply_float(string_view type) noexcept {
+  return (type == "float") || (type == "float32");
+}
+
+// Byte layout of the supported PLY files
+// as it is described by the header.
+//
+struct ply_layout {
+  static constexpr size_t none = -1;
+
+  size_t vertex_count = 0;
+  size_t vertex_stride = 0;
+  array<size_t, 3> position{none, none, none};
+  array<size_t, 3> normal{none, none, none};
+  size_t face_count = 0;
+  // Offset of the binary data behind the header
+  size_t data = 0;
+
+  auto has_normals() const noexcept {
+    return (normal[0] != none) && (normal[1] != none) && (normal[2] != none);
+  }
+};
+
+auto ply_layout_from(string_view file) -> ply_layout {
+  constexpr string_view end_header = "end_header";
+  const auto end = file.find(end_header);
+  if (end == string_view::npos)
+    throw runtime_error("The file contains no PLY header.");
+  const auto data = file.find('\n', end);
+  if (data == string_view::npos)
+    throw runtime_error("The PLY header is not terminated.");
+
+  ply_layout layout{.data = data + 1};
+  istringstream header{string(file.substr(0, end))};
+  string line{};
+
+  getline(header, line);
+  if (!line.starts_with("ply")) throw runtime_error("The file is no PLY file.");
+
+  enum { none, vertex, face, other } element = none;
+  size_t face_properties = 0;
+  while (getline(header, line)) {
+    istringstream input{line};
+    string keyword{};
+    input >> keyword;
+    if (keyword.empty() || (keyword == "comment") || (keyword == "obj_info"))
+      continue;
+
+    if (keyword == "format") {
+      string format{};
+      input >> format;
+      if (format != "binary_little_endian")
+        throw unsupported_ply_layout(
+            "Only binary little-endian PLY files are supported.");
+      continue;
+    }
+
+    if (keyword == "element") {
+      string name{};
+      size_t count = 0;
+      input >> name >> count;
+      if (!input) throw runtime_error("Failed to parse element.");
+      if ((element == none) && (name == "vertex")) {
+        element = vertex;
+        layout.vertex_count = count;
+      } else if ((element == vertex) && (name == "face")) {
+        element = face;
+        layout.face_count = count;
+      } else if (element == face || element == other) {
+        // Elements behind the faces do not need to be read.
+        element = other;
+      } else
+        throw unsupported_ply_layout(
+            "Elements 'vertex' and 'face' are expected first.");
+      continue;
+    }
+
+    if (keyword == "property") {
+      string type{};
+      input >> type;
+      if (element == vertex) {
+        string name{};
+        input >> name;
+        const auto size = ply_scalar_size(type);
+        if (size == 0)
+          throw unsupported_ply_layout("Vertex properties need to be scalars.");
+        const auto set = [&](auto& offsets, size_t i) {
+          if (!ply_float(type))
+            throw unsupported_ply_layout("Vertex property '"s + name +
+                                         "' needs to be a float.");
+          offsets[i] = layout.vertex_stride;
+        };
+        if (name == "x") set(layout.position, 0);
+        if (name == "y") set(layout.position, 1);
+        if (name == "z") set(layout.position, 2);
+        if (name == "nx" && ply_float(type)) set(layout.normal, 0);
+        if (name == "ny" && ply_float(type)) set(layout.normal, 1);
+        if (name == "nz" && ply_float(type)) set(layout.normal, 2);
+        layout.vertex_stride += size;
+      } else if (element == face) {
+        string count_type{}, index_type{}, name{};
+        input >> count_type >> index_type >> name;
+        if ((type != "list") ||
+            ((count_type != "uchar") && (count_type != "uint8")) ||
+            (ply_scalar_size(index_type) != 4) || ply_float(index_type) ||
+            ((name != "vertex_indices") && (name != "vertex_index")))
+          throw unsupported_ply_layout(
+              "Faces need to be given as 'list uchar int vertex_indices'.");
+        if (++face_properties > 1)
+          throw unsupported_ply_layout(
+              "Faces may only provide vertex indices.");
+      }
+      continue;
+    }
+  }
+
+  if (element == none) throw runtime_error("The file contains no vertices.");
+  for (auto offset : layout.position)
+    if (offset == ply_layout::none)
+      throw runtime_error("Vertices need the properties 'x', 'y', and 'z'.");
+  if ((layout.face_count > 0) && (face_properties == 0))
+    throw unsupported_ply_layout("Faces provide no vertex indices.");
+  return layout;
+}
+
+// Every triangle of the writer and of most files is stored
+// as 8-bit count followed by three 32-bit indices.
+//
+constexpr size_t ply_triangle_size = 1 + 3 * sizeof(uint32);
+
+}  // namespace
+
+auto polyhedral_surface_from_ply_file(const filesystem::path& path)
+    -> polyhedral_surface {
+  using size_type = polyhedral_surface::size_type;
+
+  const auto message = [&](const string& str) {
+    return "Failed to load PLY file from path '"s + path.string() + "'. " +
+           str;
+  };
+  const auto throw_error = [&](const string& str) {
+    throw runtime_error(message(str));
+  };
+
+  const memory_mapped_file file{path};
+  ply_layout layout{};
+  try {
+    layout = ply_layout_from(file);
+  } catch (const unsupported_ply_layout& e) {
+    throw unsupported_ply_layout(message(e.what()));
+  } catch (const exception& e) {
+    throw_error(e.what());
+  }
+
+  if (layout.vertex_count >= polyhedral_surface::invalid)
+    throw_error("The file contains too many vertices.");
+  // Counts of the header are not trusted.
+  // Their products could wrap around and are therefore checked by division.
+  //
+  if (layout.vertex_count >
+      (file.size() - layout.data) / std::max(layout.vertex_stride, size_t{1}))
+    throw_error("The file is too small for the given number of vertices.");
+  const auto vertex_bytes = layout.vertex_count * layout.vertex_stride;
+
+  polyhedral_surface surface{};
+  surface.vertices.resize(layout.vertex_count);
+
+  // Vertices
+  //
+  const auto vertices = file.data() + layout.data;
+  static_assert(sizeof(polyhedral_surface::vertex) == 6 * sizeof(float32));
+  const bool packed = (layout.vertex_stride == 6 * sizeof(float32)) &&
+                      (layout.position == array<size_t, 3>{0, 4, 8}) &&
+                      (layout.normal == array<size_t, 3>{12, 16, 20});
+  if (packed) {
+    // The layout of the file equals the layout in memory.
+    // This is the case for all files written by 'save_ply_file'.
+    memcpy(surface.vertices.data(), vertices, vertex_bytes);
+  } else {
+    const auto has_normals = layout.has_normals();
+    parallel_for(0, layout.vertex_count, [&](size_t i) {
+      const auto src = vertices + i * layout.vertex_stride;
+      auto& v = surface.vertices[i];
+      for (size_t j = 0; j < 3; ++j) {
+        memcpy(&v.position[j], src + layout.position[j], sizeof(float32));
+        if (has_normals)
+          memcpy(&v.normal[j], src + layout.normal[j], sizeof(float32));
+      }
+    });
+  }
+
+  // Faces
+  //
+  const auto faces = vertices + vertex_bytes;
+  const auto face_bytes = size_t(file.end() - faces);
+  const auto in_range = [&](const polyhedral_surface::face& f) {
+    return (f[0] < layout.vertex_count) && (f[1] < layout.vertex_count) &&
+           (f[2] < layout.vertex_count);
+  };
+
+  // Most files only contain triangles. Then all records have the same size.
+  // So, they can be checked and gathered in parallel.
+  //
+  atomic<bool> triangles =
+      layout.face_count <= face_bytes / ply_triangle_size;
+  if (triangles)
+    parallel_for_blocks(0, layout.face_count, [&](size_t first, size_t last) {
+      for (auto i = first; i < last; ++i)
+        if (faces[i * ply_triangle_size] != 3) {
+          triangles = false;
+          return;
+        }
+    });
+
+  if (triangles) {
+    surface.faces.resize(layout.face_count);
+    atomic<bool> out_of_range = false;
+    parallel_for(0, layout.face_count, [&](size_t i) {
+      auto& f = surface.faces[i];
+      memcpy(f.data(), faces + i * ply_triangle_size + 1, sizeof(f));
+      if (!in_range(f)) out_of_range = true;
+    });
+    if (out_of_range) throw_error("Face indices are out of range.");
+  } else {
+    // General polygons are scanned twice. The first pass checks all records
+    // and counts triangles. The second pass computes the fan triangulation.
+    //
+    size_t triangle_count = 0;
+    size_t offset = 0;
+    for (size_t i = 0; i < layout.face_count; ++i) {
+      if (offset >= face_bytes)
+        throw_error("The file is too small for the given number of faces.");
+      const auto n = size_t(uint8(faces[offset]));
+      if (n < 3) throw_error("Faces need at least three corners.");
+      offset += 1 + n * sizeof(uint32);
+      triangle_count += n - 2;
+    }
+    if (offset > face_bytes)
+      throw_error("The file is too small for the given number of faces.");
+
+    surface.faces.resize(triangle_count);
+    offset = 0;
+    size_t fid = 0;
+    for (size_t i = 0; i < layout.face_count; ++i) {
+      const auto n = size_t(uint8(faces[offset]));
+      const auto index = [&](size_t k) {
+        size_type result;
+        memcpy(&result, faces + offset + 1 + k * sizeof(uint32),
+               sizeof(result));
+        return result;
+      };
+      for (size_t k = 2; k < n; ++k) {
+        auto& f = surface.faces[fid++];
+        f = {index(0), index(k - 1), index(k)};
+        if (!in_range(f)) throw_error("Face indices are out of range.");
+      }
+      offset += 1 + n * sizeof(uint32);
+    }
+  }
+
+  if (!layout.has_normals()) compute_vertex_normals(surface);
+  return surface;
+}
+
+void save_ply_file(const polyhedral_surface& surface,
+                   const filesystem::path& path) {
+  const auto throw_error = [&](czstring str) {
+    throw runtime_error("Failed to save PLY file to path '"s + path.string() +
+                        "'. " + str);
+  };
+
+  fstream file{path, ios::out | ios::binary | ios::trunc};
+  if (!file.is_open()) throw_error("The file could not be opened.");
+
+  file << "ply\n"
+       << "format binary_little_endian 1.0\n"
+       << "comment hyperreflex\n"
+       << "element vertex " << surface.vertices.size() << '\n'
+       << "property float x\n"
+       << "property float y\n"
+       << "property float z\n"
+       << "property float nx\n"
+       << "property float ny\n"
+       << "property float nz\n"
+       << "element face " << surface.faces.size() << '\n'
+       << "property list uchar int vertex_indices\n"
+       << "end_header\n";
+
+  // The vertex layout in memory equals the layout in the file.
+  //
+  file.write(reinterpret_cast<const char*>(surface.vertices.data()),
+             surface.vertices.size() * sizeof(polyhedral_surface::vertex));
+
+  // Faces need a count in front of their indices.
+  // So, they are encoded in parallel and written in one call.
+  //
+  vector<char> faces(surface.faces.size() * ply_triangle_size);
+  parallel_for(0, surface.faces.size(), [&](size_t i) {
+    const auto dst = faces.data() + i * ply_triangle_size;
+    dst[0] = 3;
+    memcpy(dst + 1, surface.faces[i].data(), 3 * sizeof(uint32));
+  });
+  file.write(faces.data(), faces.size());
+
+  if (!file) throw_error("The file could not be written.");
+}
+
+}  // namespace hyperreflex
@@ -0,0 +1,41 @@
+#pragma once
+#include <hyperreflex/polyhedral_surface.hpp>
+
+namespace hyperreflex {
+
+/// Check whether the given path uses the file extension of PLY files.
+///
+inline auto is_ply_file(const filesystem::path& path) -> bool {
+  return (path.extension().string() == ".ply") ||
+         (path.extension().string() == ".PLY");
+}
+
+/// Exception for PLY files whose layout is valid
+/// but not supported by the custom loader, such as ASCII files.
+/// Such files may still be loaded by Assimp.
+/// Malformed files throw a plain 'runtime_error' instead.
+///
+struct unsupported_ply_layout : runtime_error {
+  using runtime_error::runtime_error;
+};
+
+/// Load a polyhedral surface from a binary little-endian PLY file.
+/// The 'vertex' element needs the float properties 'x', 'y', and 'z'.
+/// Float properties 'nx', 'ny', and 'nz' are used as vertex normals.
+/// Otherwise, normals are computed from area-weighted face normals.
+/// The 'face' element needs to consist of a single list property
+/// 'vertex_indices' with 8-bit counts and 32-bit indices.
+/// Polygons are triangulated as fans around their first corner.
+/// For all other layouts, 'unsupported_ply_layout' is thrown.
+///
+auto polyhedral_surface_from_ply_file(const filesystem::path& path)
+    -> polyhedral_surface;
+
+/// Write a polyhedral surface as binary little-endian PLY file
+/// with float vertex positions and normals
+/// and triangles given as lists of 'uchar' counts and 'int' indices.
+///
+void save_ply_file(const polyhedral_surface& surface,
+                   const filesystem::path& path);
+
+}  // namespace hyperreflex
@@ -1,5 +1,9 @@
 #include <hyperreflex/polyhedral_surface.hpp>
 //
+#include <hyperreflex/obj_surface.hpp>
+#include <hyperreflex/parallel.hpp>
+#include <hyperreflex/ply_surface.hpp>
+//
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 #include <assimp/Importer.hpp>
@@ -26,6 +30,30 @@ auto polyhedral_surface_from(const stl_surface& data) -> polyhedral_surface {
   return surface;
 }
 
+auto polyhedral_surface_from(const stl_binary_view& data)
+    -> polyhedral_surface {
+  using size_type = polyhedral_surface::size_type;
+  static_assert(same_as<size_type, stl_binary_view::size_type>);
+
+  polyhedral_surface surface{};
+  surface.vertices.resize(size_t(data.size()) * 3);
+  surface.faces.resize(data.size());
+
+  // The records are decoded in place without an intermediate triangle array.
+  //
+  parallel_for(0, data.size(), [&](size_type i) {
+    const auto normal = data.normal(i);
+    for (size_type j = 0; j < 3; ++j)
+      surface.vertices[3 * i + j] = {
+          .position = data.vertex(i, j),
+          .normal = normal,
+      };
+    surface.faces[i] = {3 * i + 0, 3 * i + 1, 3 * i + 2};
+  });
+
+  return surface;
+}
+
 auto polyhedral_surface_from(const filesystem::path& path)
     -> polyhedral_surface {
   // Generate functor for prefixed error messages.
@@ -38,10 +66,29 @@ auto polyhedral_surface_from(const filesystem::path& path)
   if (!exists(path)) throw_error("The path does not exist.");
 
   // Use a custom loader for STL files.
+  // The format is detected up front to directly call the right loader.
   //
-  if (path.extension().string() == ".stl" ||
-      path.extension().string() == ".STL")
-    return polyhedral_surface_from(stl_surface(path));
+  if (is_stl_file(path)) {
+    if (stl_surface::format_of(path) == stl_surface::format::binary)
+      return polyhedral_surface_from(stl_binary_view(path));
+    return polyhedral_surface_from(stl_surface(path, stl_surface::ascii));
+  }
+
+  // Also use a custom loader for OBJ files.
+  // It ignores all statements other than vertices and faces.
+  // So, its errors stem from malformed files and are not left to Assimp.
+  //
+  if (is_obj_file(path)) return polyhedral_surface_from_obj_file(path);
+
+  // Layouts the custom loader for binary PLY files cannot handle
+  // are left to Assimp. Errors of malformed files are passed on.
+  //
+  if (is_ply_file(path)) {
+    try {
+      return polyhedral_surface_from_ply_file(path);
+    } catch (const unsupported_ply_layout&) {
+    }
+  }
 
   // For all other file formats, assimp will do the trick.
   //
@@ -78,64 +125,145 @@ auto polyhedral_surface_from(const filesystem::path& path)
 
   // Now, transform the loaded mesh data from
   // Assimp's internal structure to a polyhedral surface.
+  // All meshes will be linearly stored in one polyhedral surface.
   //
-  polyhedral_surface surface{};
+  const span<const aiMesh* const> meshes{scene->mMeshes, scene->mNumMeshes};
 
-  // First, get the total number of vertices
-  // and faces and for all meshes.
+  // First, get the offsets of vertices and faces of all meshes.
   //
-  size_t vertex_count = 0;
-  size_t face_count = 0;
-  for (size_t i = 0; i < scene->mNumMeshes; ++i) {
-    vertex_count += scene->mMeshes[i]->mNumVertices;
-    face_count += scene->mMeshes[i]->mNumFaces;
+  vector<size_t> vertex_offsets(meshes.size() + 1);
+  vector<size_t> face_offsets(meshes.size() + 1);
+  bool missing_normals = false;
+  for (size_t mid = 0; mid < meshes.size(); ++mid) {
+    vertex_offsets[mid + 1] = vertex_offsets[mid] + meshes[mid]->mNumVertices;
+    face_offsets[mid + 1] = face_offsets[mid] + meshes[mid]->mNumFaces;
+    if (!meshes[mid]->HasNormals()) missing_normals = true;
   }
-  //
-  surface.vertices.resize(vertex_count);
-  surface.faces.resize(face_count);
+  const auto vertex_count = vertex_offsets.back();
+  const auto face_count = face_offsets.back();
+  if (vertex_count >= polyhedral_surface::invalid)
+    throw_error("The file contains too many vertices.");
 
-  // Iterate over all meshes and get the vertex and face information.
-  // All meshes will be linearly stored in one polyhedral surface.
+  // All vertices and faces are processed as one contiguous range
+  // which is split into blocks for parallel processing.
+  // Every block looks up its first mesh and then walks through the meshes.
+  // So, the work is balanced for few large and many small meshes.
   //
-  uint32 vertex_offset = 0;
-  uint32 face_offset = 0;
-  for (size_t mid = 0; mid < scene->mNumMeshes; ++mid) {
-    // Vertices of the Mesh
-    //
-    for (size_t vid = 0; vid < scene->mMeshes[mid]->mNumVertices; ++vid) {
-      surface.vertices[vid + vertex_offset] = {
-          .position = {scene->mMeshes[mid]->mVertices[vid].x,  //
-                       scene->mMeshes[mid]->mVertices[vid].y,  //
-                       scene->mMeshes[mid]->mVertices[vid].z},
-          .normal = {scene->mMeshes[mid]->mNormals[vid].x,  //
-                     scene->mMeshes[mid]->mNormals[vid].y,  //
-                     scene->mMeshes[mid]->mNormals[vid].z}};
-    }
+  const auto mesh_of = [](const vector<size_t>& offsets, size_t i) {
+    return size_t(ranges::upper_bound(offsets, i) - offsets.begin()) - 1;
+  };
 
-    // Faces of the Mesh
-    //
-    for (size_t fid = 0; fid < scene->mMeshes[mid]->mNumFaces; ++fid) {
-      // All faces need to be triangles.
-      // So, use a simple triangulation of polygons.
-      const auto corners = scene->mMeshes[mid]->mFaces[fid].mNumIndices;
-      for (size_t k = 2; k < corners; ++k) {
-        surface.faces[face_offset + fid] = {
-            scene->mMeshes[mid]->mFaces[fid].mIndices[0] + vertex_offset,  //
-            scene->mMeshes[mid]->mFaces[fid].mIndices[k - 1] +
-                vertex_offset,  //
-            scene->mMeshes[mid]->mFaces[fid].mIndices[k] + vertex_offset};
+  polyhedral_surface surface{};
+  surface.vertices.resize(vertex_count);
+  parallel_for_blocks(0, vertex_count, [&](size_t first, size_t last) {
+    for (auto mid = mesh_of(vertex_offsets, first); first < last; ++mid) {
+      const auto mesh = meshes[mid];
+      const auto offset = vertex_offsets[mid];
+      const auto mesh_last = std::min(last, vertex_offsets[mid + 1]);
+      for (; first < mesh_last; ++first) {
+        const auto vid = first - offset;
+        auto& v = surface.vertices[first];
+        v.position = {mesh->mVertices[vid].x,  //
+                      mesh->mVertices[vid].y,  //
+                      mesh->mVertices[vid].z};
+        v.normal = mesh->HasNormals() ? vec3{mesh->mNormals[vid].x,  //
+                                             mesh->mNormals[vid].y,  //
+                                             mesh->mNormals[vid].z}
+                                      : vec3{};
       }
     }
+  });
 
-    // Update offsets to not overwrite previously written meshes.
-    //
-    vertex_offset += scene->mMeshes[mid]->mNumVertices;
-    face_offset += scene->mMeshes[mid]->mNumFaces;
-  }
+  // All faces need to be triangles.
+  // So, polygons are triangulated as fans around their first corner.
+  // Points and lines do not provide any triangles.
+  // The number of triangles per block is counted in a first pass
+  // to know where every block has to write its triangles in the second pass.
+  //
+  const auto for_each_face = [&](size_t first, size_t last, auto&& f) {
+    for (auto mid = mesh_of(face_offsets, first); first < last; ++mid) {
+      const auto mesh = meshes[mid];
+      const auto offset = face_offsets[mid];
+      const auto mesh_last = std::min(last, face_offsets[mid + 1]);
+      for (; first < mesh_last; ++first)
+        f(mesh->mFaces[first - offset], uint32(vertex_offsets[mid]));
+    }
+  };
+  const auto blocks = std::clamp(face_count / (size_t{1} << 12), size_t{1},
+                                 thread_count());
+  const auto block_first = [&](size_t i) { return i * face_count / blocks; };
+  vector<size_t> triangle_offsets(blocks + 1);
+  parallel_invoke(blocks, [&](size_t i) {
+    size_t triangles = 0;
+    for_each_face(block_first(i), block_first(i + 1),
+                  [&](const aiFace& face, uint32) {
+                    triangles += std::max(face.mNumIndices, 2u) - 2;
+                  });
+    triangle_offsets[i + 1] = triangles;
+  });
+  for (size_t i = 0; i < blocks; ++i)
+    triangle_offsets[i + 1] += triangle_offsets[i];
+
+  surface.faces.resize(triangle_offsets.back());
+  parallel_invoke(blocks, [&](size_t i) {
+    auto fid = triangle_offsets[i];
+    for_each_face(block_first(i), block_first(i + 1),
+                  [&](const aiFace& face, uint32 offset) {
+                    for (size_t k = 2; k < face.mNumIndices; ++k)
+                      surface.faces[fid++] = {face.mIndices[0] + offset,
+                                              face.mIndices[k - 1] + offset,
+                                              face.mIndices[k] + offset};
+                  });
+  });
 
+  if (missing_normals) compute_vertex_normals(surface);
   return surface;
 }
 
+void compute_vertex_normals(polyhedral_surface& surface) {
+  using size_type = polyhedral_surface::size_type;
+  const auto n = surface.vertices.size();
+  const auto m = surface.faces.size();
+
+  // The length of the cross product of two edges
+  // is twice the area of the face.
+  // So, no further weighting is needed.
+  //
+  vector<vec3> normals(m);
+  parallel_for(0, m, [&](size_t i) {
+    const auto& v = surface.vertices;
+    const auto& f = surface.faces[i];
+    normals[i] = cross(v[f[1]].position - v[f[0]].position,
+                       v[f[2]].position - v[f[0]].position);
+  });
+
+  // Gather the adjacent faces of all vertices in a compressed row format.
+  // Sorting the faces of every vertex makes the summation order
+  // and thereby the result independent of the thread scheduling.
+  //
+  vector<atomic<size_type>> counts(n + 1);
+  parallel_for(0, m, [&](size_t i) {
+    for (auto vid : surface.faces[i]) ++counts[vid + 1];
+  });
+  vector<size_type> offsets(n + 1);
+  for (size_t i = 0; i < n; ++i) offsets[i + 1] = offsets[i] + counts[i + 1];
+  parallel_for(0, n, [&](size_t i) { counts[i] = offsets[i]; });
+  vector<size_type> adjacent_faces(offsets.back());
+  parallel_for(0, m, [&](size_t i) {
+    for (auto vid : surface.faces[i]) adjacent_faces[counts[vid]++] = i;
+  });
+
+  parallel_for(0, n, [&](size_t i) {
+    const auto first = begin(adjacent_faces) + offsets[i];
+    const auto last = begin(adjacent_faces) + offsets[i + 1];
+    sort(first, last);
+    vec3 normal{};
+    for (auto it = first; it != last; ++it) normal += normals[*it];
+    const auto l = length(normal);
+    if (l > 0) surface.vertices[i].normal = normal / l;
+  });
+}
+
 auto aabb_from(const polyhedral_surface& surface) noexcept -> aabb3 {
   return hyperreflex::aabb_from(
       surface.vertices |
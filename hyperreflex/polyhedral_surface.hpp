@@ -27,9 +27,16 @@ struct polyhedral_surface {
 
 auto polyhedral_surface_from(const stl_surface& data) -> polyhedral_surface;
 
+auto polyhedral_surface_from(const stl_binary_view& data) -> polyhedral_surface;
+
 auto polyhedral_surface_from(const filesystem::path& path)
     -> polyhedral_surface;
 
+/// Recompute all vertex normals as the normalized sum
+/// of adjacent face normals weighted by their face areas.
+///
+void compute_vertex_normals(polyhedral_surface& surface);
+
 /// Constructor Extension for AABB
 /// Get the bounding box around a polyhedral surface.
 ///
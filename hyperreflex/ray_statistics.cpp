@@ -0,0 +1,114 @@
+#include <hyperreflex/ray_statistics.hpp>
+
+namespace hyperreflex {
+
+namespace {
+
+// Counters of one thread that may be read by other threads.
+// Only the owning thread writes them. So, relaxed loads and stores
+// suffice and avoid the cost of atomic read-modify-write operations.
+//
+struct thread_counters {
+  static void add(atomic<uint64>& x, uint64 value) noexcept {
+    x.store(x.load(memory_order_relaxed) + value, memory_order_relaxed);
+  }
+
+  void add(const ray_statistics& x) noexcept {
+    add(rays, x.rays);
+    add(nodes, x.nodes);
+    add(triangles, x.triangles);
+    add(hits, x.hits);
+    add(nanoseconds, x.nanoseconds);
+  }
+
+  auto load() const noexcept {
+    return ray_statistics{rays.load(memory_order_relaxed),
+                          nodes.load(memory_order_relaxed),
+                          triangles.load(memory_order_relaxed),
+                          hits.load(memory_order_relaxed),
+                          nanoseconds.load(memory_order_relaxed)};
+  }
+
+  void reset() noexcept {
+    rays.store(0, memory_order_relaxed);
+    nodes.store(0, memory_order_relaxed);
+    triangles.store(0, memory_order_relaxed);
+    hits.store(0, memory_order_relaxed);
+    nanoseconds.store(0, memory_order_relaxed);
+  }
+
+  atomic<uint64> rays{};
+  atomic<uint64> nodes{};
+  atomic<uint64> triangles{};
+  atomic<uint64> hits{};
+  atomic<uint64> nanoseconds{};
+};
+
+// All running threads register their counters.
+// Threads that finish add their counters to the ones of finished threads.
+//
+struct thread_registry {
+  mutex m{};
+  vector<thread_counters*> running{};
+  ray_statistics finished{};
+};
+
+auto registry() -> thread_registry& {
+  static thread_registry instance{};
+  return instance;
+}
+
+struct registered_thread_counters : thread_counters {
+  registered_thread_counters() {
+    auto& r = registry();
+    scoped_lock lock{r.m};
+    r.running.push_back(this);
+  }
+
+  ~registered_thread_counters() {
+    auto& r = registry();
+    scoped_lock lock{r.m};
+    r.finished += load();
+    erase(r.running, this);
+  }
+};
+
+auto local_counters() -> registered_thread_counters& {
+  thread_local registered_thread_counters counters{};
+  return counters;
+}
+
+}  // namespace
+
+void record(const ray_statistics& query) noexcept {
+  local_counters().add(query);
+}
+
+auto thread_ray_statistics() noexcept -> ray_statistics {
+  return local_counters().load();
+}
+
+auto total_ray_statistics() -> ray_statistics {
+  auto& r = registry();
+  scoped_lock lock{r.m};
+  auto result = r.finished;
+  for (auto counters : r.running) result += counters->load();
+  return result;
+}
+
+void reset_ray_statistics() {
+  auto& r = registry();
+  scoped_lock lock{r.m};
+  r.finished = {};
+  for (auto counters : r.running) counters->reset();
+}
+
+auto operator<<(ostream& os, const ray_statistics& x) -> ostream& {
+  const auto rays = float64(std::max(x.rays, uint64{1}));
+  return os << x.rays << " rays, " << x.nodes / rays << " nodes/ray, "
+            << x.triangles / rays << " triangles/ray, "
+            << 100.0 * x.hits / rays << " % hits, "
+            << x.nanoseconds_per_ray() << " ns/ray";
+}
+
+}  // namespace hyperreflex
@@ -0,0 +1,123 @@
+#pragma once
+#include <hyperreflex/utility.hpp>
+
+namespace hyperreflex {
+
+/// Ray queries only count their work if the build defines
+/// 'HYPERREFLEX_RAY_STATISTICS' by 'config.hyperreflex.ray_statistics'.
+/// Otherwise, all counting code is removed by the compiler.
+///
+#ifdef HYPERREFLEX_RAY_STATISTICS
+constexpr bool ray_statistics_enabled = true;
+#else
+constexpr bool ray_statistics_enabled = false;
+#endif
+
+/// Work done by a number of ray queries
+///
+struct ray_statistics {
+  auto nanoseconds_per_ray() const noexcept {
+    return float64(nanoseconds) / std::max(rays, uint64{1});
+  }
+
+  auto operator+=(const ray_statistics& x) noexcept -> ray_statistics& {
+    rays += x.rays;
+    nodes += x.nodes;
+    triangles += x.triangles;
+    hits += x.hits;
+    nanoseconds += x.nanoseconds;
+    return *this;
+  }
+
+  auto operator-=(const ray_statistics& x) noexcept -> ray_statistics& {
+    rays -= x.rays;
+    nodes -= x.nodes;
+    triangles -= x.triangles;
+    hits -= x.hits;
+    nanoseconds -= x.nanoseconds;
+    return *this;
+  }
+
+  friend auto operator+(ray_statistics x, const ray_statistics& y) noexcept {
+    return x += y;
+  }
+
+  friend auto operator-(ray_statistics x, const ray_statistics& y) noexcept {
+    return x -= y;
+  }
+
+  uint64 rays{};
+  // Visited nodes whose children or triangles have been tested
+  uint64 nodes{};
+  // Tested triangles including the unused lanes of triangle blocks
+  uint64 triangles{};
+  // Rays that hit the surface or found an occluder
+  uint64 hits{};
+  // Wall-clock time spent inside of the queries
+  uint64 nanoseconds{};
+};
+
+/// Counters of all ray queries of the calling thread.
+/// Their difference before and after a query is the work of this query.
+///
+auto thread_ray_statistics() noexcept -> ray_statistics;
+
+/// Counters of all ray queries of all threads since the last reset
+/// including the ones of threads that have already finished.
+///
+auto total_ray_statistics() -> ray_statistics;
+
+/// Set the counters of all threads to zero.
+/// Queries that run concurrently might still be counted afterwards.
+///
+void reset_ray_statistics();
+
+/// Print the counters in a single line together with averages per ray.
+///
+auto operator<<(ostream& os, const ray_statistics& x) -> ostream&;
+
+/// Add the work of a single query to the counters of the calling thread.
+///
+void record(const ray_statistics& query) noexcept;
+
+/// Counters of a single query that are recorded when it goes out of scope.
+/// Queries use it to count their work without any cost
+/// if the ray statistics are disabled.
+///
+class ray_query_statistics {
+ public:
+  ray_query_statistics() noexcept {
+    if constexpr (ray_statistics_enabled) start = clock::now();
+  }
+
+  ~ray_query_statistics() noexcept {
+    if constexpr (ray_statistics_enabled) {
+      counters.rays = 1;
+      counters.nanoseconds =
+          chrono::duration_cast<chrono::nanoseconds>(clock::now() - start)
+              .count();
+      record(counters);
+    }
+  }
+
+  ray_query_statistics(const ray_query_statistics&) = delete;
+  ray_query_statistics& operator=(const ray_query_statistics&) = delete;
+
+  void visit_node() noexcept {
+    if constexpr (ray_statistics_enabled) ++counters.nodes;
+  }
+
+  void test_triangles(size_t count) noexcept {
+    if constexpr (ray_statistics_enabled) counters.triangles += count;
+  }
+
+  void hit(bool found) noexcept {
+    if constexpr (ray_statistics_enabled) counters.hits = found;
+  }
+
+ private:
+  ray_statistics counters{};
+  clock::time_point start{};
+};
+
+}  // namespace hyperreflex
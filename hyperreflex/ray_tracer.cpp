@@ -1,5 +1,10 @@
 #include <hyperreflex/ray_tracer.hpp>
 
+// The SIMD kernel has to provide the exact same results as the scalar test.
+// The contraction of multiplications and additions into FMA instructions
+// would round differently and is therefore disabled for both.
+#pragma GCC optimize("fp-contract=off")
+
 namespace hyperreflex {
 
 auto intersection(const ray& r, const triangle& f) noexcept
@@ -18,20 +23,324 @@ auto intersection(const ray& r, const triangle& f) noexcept
   return {u, v, t};
 }
 
+namespace {
+
+using face_id = triangle_blocks::face_id;
+
+// The kernel uses the vector extensions of GCC and Clang.
+// Other compilers, such as MSVC, test the lanes one after another.
+// Kernels for wider instruction sets are only compiled by GCC on x86.
+//
+#if defined(__GNUC__)
+#define HYPERREFLEX_VECTOR_EXTENSIONS
+#endif
+#if defined(__GNUC__) && !defined(__clang__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define HYPERREFLEX_TARGET_KERNELS
+#endif
+
+#ifdef HYPERREFLEX_VECTOR_EXTENSIONS
+
+// Vector types of GCC and Clang for every kernel width
+//
+template <size_t width>
+struct simd;
+template <>
+struct simd<4> {
+  using type = float32 __attribute__((vector_size(4 * sizeof(float32))));
+};
+template <>
+struct simd<8> {
+  using type = float32 __attribute__((vector_size(8 * sizeof(float32))));
+};
+template <>
+struct simd<16> {
+  using type = float32 __attribute__((vector_size(16 * sizeof(float32))));
+};
+
+// Möller–Trumbore test of one ray against blocks of 'width' triangles.
+// The operations are the ones of 'glm::cross' and 'glm::dot'
+// in the same order as used by the scalar version.
+// For closest hits, 'result' is updated by every closer hit.
+// For any hits, the test returns at the first hit closer than 'result.t'.
+// Every variant is instantiated below for its own instruction set.
+//
+template <size_t width, bool any_hit>
+auto test_blocks(const ray& r,
+                 const float32* data,
+                 const face_id* faces,
+                 size_t count,
+                 ray_polyhedral_surface_intersection& result) noexcept
+    -> bool {
+  using real = typename simd<width>::type;
+
+  const real ox = real{} + r.origin.x;
+  const real oy = real{} + r.origin.y;
+  const real oz = real{} + r.origin.z;
+  const real dx = real{} + r.direction.x;
+  const real dy = real{} + r.direction.y;
+  const real dz = real{} + r.direction.z;
+
+  for (size_t b = 0; b < count; ++b) {
+    // Every component of the block is one vector.
+    // Blocks are only aligned to floats and therefore copied.
+    const auto block = data + b * triangle_blocks::components * width;
+    real v0x, v0y, v0z, e1x, e1y, e1z, e2x, e2y, e2z;
+    memcpy(&v0x, block + 0 * width, sizeof(real));
+    memcpy(&v0y, block + 1 * width, sizeof(real));
+    memcpy(&v0z, block + 2 * width, sizeof(real));
+    memcpy(&e1x, block + 3 * width, sizeof(real));
+    memcpy(&e1y, block + 4 * width, sizeof(real));
+    memcpy(&e1z, block + 5 * width, sizeof(real));
+    memcpy(&e2x, block + 6 * width, sizeof(real));
+    memcpy(&e2y, block + 7 * width, sizeof(real));
+    memcpy(&e2z, block + 8 * width, sizeof(real));
+
+    // p = cross(direction, edge2)
+    const real px = dy * e2z - e2y * dz;
+    const real py = dz * e2x - e2z * dx;
+    const real pz = dx * e2y - e2x * dy;
+    // determinant = dot(edge1, p)
+    const real determinant = e1x * px + e1y * py + e1z * pz;
+    const real inverse_determinant = 1.0f / determinant;
+    // s = origin - v0
+    const real sx = ox - v0x;
+    const real sy = oy - v0y;
+    const real sz = oz - v0z;
+    const real u = (sx * px + sy * py + sz * pz) * inverse_determinant;
+    // q = cross(s, edge1)
+    const real qx = sy * e1z - e1y * sz;
+    const real qy = sz * e1x - e1z * sx;
+    const real qz = sx * e1y - e1x * sy;
+    const real v = (dx * qx + dy * qy + dz * qz) * inverse_determinant;
+    const real t = (e2x * qx + e2y * qy + e2z * qz) * inverse_determinant;
+
+    // Hits behind the current closest one are discarded in advance.
+    // Most blocks contain no candidate at all.
+    const auto valid = (determinant != 0.0f) & (u >= 0.0f) & (v >= 0.0f) &
+                       (u + v <= 1.0f) & (t > 0.0f);
+    const auto hit = valid & (any_hit ? (t < result.t) : (t <= result.t));
+    auto candidates = hit[0];
+    for (size_t i = 1; i < width; ++i) candidates |= hit[i];
+    if (!candidates) continue;
+    if constexpr (any_hit) return true;
+
+    const auto ids = faces + b * width;
+    for (size_t i = 0; i < width; ++i) {
+      if (!hit[i]) continue;
+      if (!((t[i] < result.t) ||
+            ((t[i] == result.t) && result && (ids[i] < result.f))))
+        continue;
+      result.u = u[i];
+      result.v = v[i];
+      result.t = t[i];
+      result.f = ids[i];
+    }
+  }
+  return false;
+}
+
+#else
+
+// Scalar variant of the kernel with the same operations per lane
+//
+template <size_t width, bool any_hit>
+auto test_blocks(const ray& r,
+                 const float32* data,
+                 const face_id* faces,
+                 size_t count,
+                 ray_polyhedral_surface_intersection& result) noexcept
+    -> bool {
+  const auto ox = r.origin.x, oy = r.origin.y, oz = r.origin.z;
+  const auto dx = r.direction.x, dy = r.direction.y, dz = r.direction.z;
+
+  for (size_t b = 0; b < count; ++b) {
+    const auto block = data + b * triangle_blocks::components * width;
+    for (size_t i = 0; i < width; ++i) {
+      const auto v0x = block[0 * width + i];
+      const auto v0y = block[1 * width + i];
+      const auto v0z = block[2 * width + i];
+      const auto e1x = block[3 * width + i];
+      const auto e1y = block[4 * width + i];
+      const auto e1z = block[5 * width + i];
+      const auto e2x = block[6 * width + i];
+      const auto e2y = block[7 * width + i];
+      const auto e2z = block[8 * width + i];
+
+      const float32 px = dy * e2z - e2y * dz;
+      const float32 py = dz * e2x - e2z * dx;
+      const float32 pz = dx * e2y - e2x * dy;
+      const float32 determinant = e1x * px + e1y * py + e1z * pz;
+      if (determinant == 0.0f) continue;
+      const float32 inverse_determinant = 1.0f / determinant;
+      const float32 sx = ox - v0x;
+      const float32 sy = oy - v0y;
+      const float32 sz = oz - v0z;
+      const float32 u = (sx * px + sy * py + sz * pz) * inverse_determinant;
+      const float32 qx = sy * e1z - e1y * sz;
+      const float32 qy = sz * e1x - e1z * sx;
+      const float32 qz = sx * e1y - e1x * sy;
+      const float32 v = (dx * qx + dy * qy + dz * qz) * inverse_determinant;
+      const float32 t = (e2x * qx + e2y * qy + e2z * qz) * inverse_determinant;
+
+      if (!((u >= 0.0f) && (v >= 0.0f) && (u + v <= 1.0f) && (t > 0.0f)))
+        continue;
+      if constexpr (any_hit) {
+        if (t < result.t) return true;
+        continue;
+      }
+      const auto id = faces[b * width + i];
+      if (!((t < result.t) || ((t == result.t) && result && (id < result.f))))
+        continue;
+      result.u = u;
+      result.v = v;
+      result.t = t;
+      result.f = id;
+    }
+  }
+  return false;
+}
+
+#endif
+
+// Store a triangle in the given lane of a block.
+// The edges are computed exactly as in the scalar test.
+//
+void store(float32* block,
+           size_t width,
+           size_t lane,
+           const triangle& t) noexcept {
+  const auto edge1 = t[1] - t[0];
+  const auto edge2 = t[2] - t[0];
+  const array<float32, triangle_blocks::components> values{
+      t[0].x,  t[0].y,  t[0].z,  edge1.x, edge1.y,
+      edge1.z, edge2.x, edge2.y, edge2.z};
+  for (size_t i = 0; i < values.size(); ++i)
+    block[i * width + lane] = values[i];
+}
+
+// GCC lowers vector operations a function's target does not support
+// before inlining it. So, a target attribute on a caller does not suffice
+// and the kernels are instantiated with the target set by pragmas.
+// Elsewhere, only the narrowest kernel is selected at runtime.
+//
+#define HYPERREFLEX_INSTANTIATE_KERNELS(width)                            \
+  template auto test_blocks<width, false>(                                \
+      const ray&, const float32*, const face_id*, size_t,                 \
+      ray_polyhedral_surface_intersection&) noexcept -> bool;             \
+  template auto test_blocks<width, true>(                                 \
+      const ray&, const float32*, const face_id*, size_t,                 \
+      ray_polyhedral_surface_intersection&) noexcept -> bool;
+
+#ifdef HYPERREFLEX_TARGET_KERNELS
+HYPERREFLEX_INSTANTIATE_KERNELS(4)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+HYPERREFLEX_INSTANTIATE_KERNELS(8)
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+HYPERREFLEX_INSTANTIATE_KERNELS(16)
+#pragma GCC pop_options
+#endif
+
+#undef HYPERREFLEX_INSTANTIATE_KERNELS
+
+using kernel = auto (*)(const ray&,
+                        const float32*,
+                        const face_id*,
+                        size_t,
+                        ray_polyhedral_surface_intersection&) noexcept -> bool;
+
+template <bool any_hit>
+auto kernel_of(size_t width) noexcept -> kernel {
+  switch (width) {
+    case 16:
+      return test_blocks<16, any_hit>;
+    case 8:
+      return test_blocks<8, any_hit>;
+    default:
+      return test_blocks<4, any_hit>;
+  }
+}
+
+}  // namespace
+
+auto simd_width() noexcept -> size_t {
+  static const size_t width = [] {
+#ifdef HYPERREFLEX_TARGET_KERNELS
+    if (__builtin_cpu_supports("avx512f")) return 16;
+    if (__builtin_cpu_supports("avx2")) return 8;
+#endif
+    return 4;
+  }();
+  return width;
+}
+
+void triangle_blocks::set(size_t b,
+                          size_t lane,
+                          const triangle& t,
+                          face_id f) noexcept {
+  store(data.data() + components * width * b, width, lane, t);
+  faces[b * width + lane] = f;
+}
+
+void intersect_blocks(const ray& r,
+                      const triangle_blocks& blocks,
+                      size_t first,
+                      size_t last,
+                      ray_polyhedral_surface_intersection& result) noexcept {
+  kernel_of<false>(blocks.width)(r, blocks.block(first),
+                                 blocks.faces.data() + first * blocks.width,
+                                 last - first, result);
+}
+
+auto occluded(const ray& r,
+              const triangle_blocks& blocks,
+              size_t first,
+              size_t last,
+              float32 tmax) noexcept -> bool {
+  ray_polyhedral_surface_intersection result{};
+  result.t = tmax;
+  return kernel_of<true>(blocks.width)(r, blocks.block(first), nullptr,
+                                       last - first, result);
+}
+
+auto intersection(const ray& r, const triangle_blocks& blocks) noexcept
+    -> ray_polyhedral_surface_intersection {
+  ray_polyhedral_surface_intersection result{};
+  result.t = infinity;
+  intersect_blocks(r, blocks, 0, blocks.size(), result);
+  return result;
+}
+
 auto intersection(const ray& r, const polyhedral_surface& surface) noexcept
     -> ray_polyhedral_surface_intersection {
+  ray_query_statistics statistics{};
   ray_polyhedral_surface_intersection result{};
   result.t = infinity;
-  for (size_t i = 0; i < surface.faces.size(); ++i) {
-    const auto& v = surface.vertices;
-    const auto& f = surface.faces[i];
-    if (const auto p = intersection(
-            r, {v[f[0]].position, v[f[1]].position, v[f[2]].position})) {
-      if (p.t >= result.t) continue;
-      static_cast<ray_triangle_intersection&>(result) = p;
-      result.f = i;
+
+  // Faces are gathered into one block after another
+  // and tested by the SIMD kernel.
+  const auto width = simd_width();
+  const auto intersect = kernel_of<false>(width);
+  const auto& v = surface.vertices;
+  array<float32, triangle_blocks::components * 16> data;
+  array<face_id, 16> faces;
+  for (size_t first = 0; first < surface.faces.size(); first += width) {
+    data.fill(0.0f);
+    faces.fill(polyhedral_surface::invalid);
+    const auto count = std::min(width, surface.faces.size() - first);
+    for (size_t lane = 0; lane < count; ++lane) {
+      const auto& f = surface.faces[first + lane];
+      store(data.data(), width, lane,
+            {v[f[0]].position, v[f[1]].position, v[f[2]].position});
+      faces[lane] = first + lane;
     }
+    intersect(r, data.data(), faces.data(), 1, result);
   }
+  statistics.test_triangles(surface.faces.size());
+  statistics.hit(result);
   return result;
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 #include <hyperreflex/polyhedral_surface.hpp>
+#include <hyperreflex/ray_statistics.hpp>
 
 namespace hyperreflex {
 
@@ -35,4 +36,65 @@ struct ray_polyhedral_surface_intersection : ray_triangle_intersection {
 auto intersection(const ray& r, const polyhedral_surface& scene) noexcept
     -> ray_polyhedral_surface_intersection;
 
+/// Number of triangles that are tested at once by the SIMD kernel
+/// on the running processor. It is 16 for AVX-512, 8 for AVX2, and 4 otherwise.
+/// The wider kernels are only compiled for their instruction sets by GCC.
+/// For all other compilers, the width is always 4.
+///
+auto simd_width() noexcept -> size_t;
+
+/// Triangles stored in blocks of 'width' triangles for the SIMD kernel.
+/// Every block stores the first vertex and both edges of its triangles
+/// as nine arrays of 'width' components (SoA).
+/// Lanes without a triangle are zero and have an invalid face index.
+///
+struct triangle_blocks {
+  using face_id = polyhedral_surface::face_id;
+  static constexpr size_t components = 9;
+
+  triangle_blocks() = default;
+  triangle_blocks(size_t width, size_t count)
+      : width{width},
+        data(components * width * count),
+        faces(width * count, polyhedral_surface::invalid) {}
+
+  auto size() const noexcept { return faces.size() / width; }
+
+  auto block(size_t b) const noexcept -> const float32* {
+    return data.data() + components * width * b;
+  }
+
+  void set(size_t b, size_t lane, const triangle& t, face_id f) noexcept;
+
+  size_t width = 4;
+  vector<float32> data{};
+  vector<face_id> faces{};
+};
+
+/// Test a ray against all triangles of the blocks '[first, last)'
+/// and update 'result' if a closer hit is found.
+/// For equal distances, the smaller face index wins.
+/// All hits are bit-identical to the scalar triangle test.
+///
+void intersect_blocks(const ray& r,
+                      const triangle_blocks& blocks,
+                      size_t first,
+                      size_t last,
+                      ray_polyhedral_surface_intersection& result) noexcept;
+
+/// Check whether the ray hits any triangle of the blocks '[first, last)'
+/// in front of its origin and closer than 'tmax'.
+/// The test stops at the first block with such a hit.
+///
+auto occluded(const ray& r,
+              const triangle_blocks& blocks,
+              size_t first,
+              size_t last,
+              float32 tmax) noexcept -> bool;
+
+/// Brute-force query against all blocks.
+///
+auto intersection(const ray& r, const triangle_blocks& blocks) noexcept
+    -> ray_polyhedral_surface_intersection;
+
 }  // namespace hyperreflex
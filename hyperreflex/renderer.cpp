@@ -0,0 +1,265 @@
+#include <hyperreflex/parallel.hpp>
+#include <hyperreflex/renderer.hpp>
+
+namespace hyperreflex {
+
+void save_ppm_file(const rgb_image& image, const filesystem::path& path) {
+  fstream file{path, ios::out | ios::binary | ios::trunc};
+  if (!file.is_open())
+    throw runtime_error("Failed to save PPM file to path '"s + path.string() +
+                        "'. The file could not be opened.");
+  file << "P6\n" << image.width << ' ' << image.height << "\n255\n";
+  file.write(reinterpret_cast<const char*>(image.pixels.data()),
+             image.pixels.size() * sizeof(rgb_image::pixel));
+}
+
+void save_image_file(const rgb_image& image, const filesystem::path& path) {
+  if (path.extension() == ".ppm") {
+    save_ppm_file(image, path);
+    return;
+  }
+  vector<uint8> rgba(4 * image.pixels.size());
+  for (size_t i = 0; i < image.pixels.size(); ++i) {
+    const auto& p = image.pixels[i];
+    rgba[4 * i + 0] = p[0];
+    rgba[4 * i + 1] = p[1];
+    rgba[4 * i + 2] = p[2];
+    rgba[4 * i + 3] = 255;
+  }
+  sf::Image data{};
+  data.create(image.width, image.height, rgba.data());
+  if (!data.saveToFile(path.string()))
+    throw runtime_error("Failed to save image file to path '"s +
+                        path.string() + "'.");
+}
+
+auto heat_color(float32 x) noexcept -> vec3 {
+  // The constants are the ones of 'shader/heat/fs.glsl'.
+  const auto f = [x](float32 a, float32 b, float32 c, float32 d) {
+    return a * sin(2.0f * pi / b * x + 2.0f * pi * c) + d;
+  };
+  const auto red = f(126.9634465941118f, 1.011727672706345f,
+                     0.0038512319231245f + 0.5f, 127.5277540583575f);
+  const auto green = f(63.19460736097507f, 0.06323746667143024f,
+                       0.06208443629833329f, 96.56305326777574f);
+  const auto blue = f(126.9634465941118f, 1.011727672706345f,
+                      0.0038512319231245f, 127.5277540583575f);
+  return clamp(vec3{red, green, blue} / 255.0f, 0.0f, 1.0f);
+}
+
+namespace {
+
+// Curve segments in pixel coordinates
+//
+struct segment {
+  vec2 a, b;
+  float32 radius;
+  size_t curve;
+};
+
+// Pixel coordinates of a point in front of the camera
+// such that 'primary_ray' at these coordinates passes through it.
+//
+auto pixel_of(const camera& cam, const vec3& p) noexcept -> vec2 {
+  const auto d = p - cam.position();
+  const auto scale = 1.0f / (dot(d, cam.direction()) * cam.pixel_size());
+  return {0.5f * cam.screen_width() + scale * dot(d, cam.right()),
+          0.5f * cam.screen_height() - scale * dot(d, cam.up())};
+}
+
+auto distance(const vec2& p, const vec2& a, const vec2& b) noexcept {
+  const auto e = b - a;
+  const auto e2 = dot(e, e);
+  const auto s = (e2 > 0) ? std::clamp(dot(p - a, e) / e2, 0.0f, 1.0f) : 0.0f;
+  return length(p - a - s * e);
+}
+
+// Distance of a point to the line through 'a' and 'b'
+//
+auto line_distance(const vec2& p, const vec2& a, const vec2& b) noexcept {
+  const auto e = b - a;
+  const auto l = length(e);
+  if (l == 0) return length(p - a);
+  return abs(e.x * (p.y - a.y) - e.y * (p.x - a.x)) / l;
+}
+
+auto smoothstep(float32 e0, float32 e1, float32 x) noexcept {
+  const auto t = std::clamp((x - e0) / (e1 - e0), 0.0f, 1.0f);
+  return t * t * (3.0f - 2.0f * t);
+}
+
+auto segments_of(const camera& cam, span<const render_curve> curves)
+    -> vector<segment> {
+  vector<segment> result{};
+  for (size_t c = 0; c < curves.size(); ++c) {
+    const auto& points = curves[c].points;
+    for (size_t i = 1; i < points.size(); ++i) {
+      auto p = points[i - 1];
+      auto q = points[i];
+      // Segments are clipped at the near plane.
+      const auto zp = dot(p - cam.position(), cam.direction()) - cam.near();
+      const auto zq = dot(q - cam.position(), cam.direction()) - cam.near();
+      if ((zp < 0) && (zq < 0)) continue;
+      if (zp < 0) p = q + (p - q) * (zq / (zq - zp));
+      if (zq < 0) q = p + (q - p) * (zp / (zp - zq));
+      result.push_back({pixel_of(cam, p), pixel_of(cam, q),
+                        0.5f * curves[c].width, c});
+    }
+  }
+  return result;
+}
+
+// Rendering by any closest-hit query for rays against the surface
+//
+auto render_with(const camera& cam,
+                 const auto& intersect,
+                 span<const polyhedral_surface::vertex> vertices,
+                 span<const polyhedral_surface::face> faces,
+                 const render_settings& settings) -> rgb_image {
+  const size_t width = cam.screen_width();
+  const size_t height = cam.screen_height();
+  rgb_image image(width, height);
+
+  const auto segments = segments_of(cam, settings.curves);
+
+  // Tiles are fetched one after another by all threads
+  // because their costs vary strongly across the image.
+  const auto tile_size = std::max(settings.tile_size, size_t{1});
+  const auto tiles_x = (width + tile_size - 1) / tile_size;
+  const auto tiles_y = (height + tile_size - 1) / tile_size;
+  const auto tiles = tiles_x * tiles_y;
+
+  const auto shade = [&](const ray& r) -> vec3 {
+    const auto p = intersect(r);
+    if (!p) return settings.background;
+
+    const auto& f = faces[p.f];
+    const auto& x = vertices[f[0]].position;
+    const auto& y = vertices[f[1]].position;
+    const auto& z = vertices[f[2]].position;
+
+    // Lighting by the face normal like the heat shader
+    const auto s = abs(dot(normalize(cross(y - x, z - x)), cam.front()));
+    auto color = vec3{0.2f + 1.0f * pow(s, 1000.0f) + 0.75f * pow(s, 0.2f)};
+    if (!settings.lighting) {
+      const auto w = 1.0f - p.u - p.v;
+      const auto heat =
+          settings.heat.empty()
+              ? 0.0f
+              : w * settings.heat[f[0]] + p.u * settings.heat[f[1]] +
+                    p.v * settings.heat[f[2]];
+      color = heat_color(heat);
+    }
+    color = clamp(color, 0.0f, 1.0f);
+
+    // Edges by their distance in pixels
+    if (settings.edges) {
+      const auto q = pixel_of(cam, r(p.t));
+      const auto a = pixel_of(cam, x);
+      const auto b = pixel_of(cam, y);
+      const auto c = pixel_of(cam, z);
+      const auto d = std::min({line_distance(q, b, c), line_distance(q, c, a),
+                               line_distance(q, a, b)});
+      const auto line_width = 0.05f;
+      const auto line_delta = 1.0f;
+      color = mix(vec3{0.2f}, color,
+                  smoothstep(line_width - line_delta,
+                             line_width + line_delta, d));
+    }
+
+    // The surface is drawn with some transparency.
+    const auto alpha = 0.8f;
+    return mix(settings.background, color, alpha);
+  };
+
+  atomic<size_t> next = 0;
+  parallel_invoke(std::min(thread_count(), tiles), [&](size_t) {
+    vector<const segment*> tile_segments{};
+    for (auto t = next++; t < tiles; t = next++) {
+      const auto x0 = (t % tiles_x) * tile_size;
+      const auto y0 = (t / tiles_x) * tile_size;
+      const auto x1 = std::min(x0 + tile_size, width);
+      const auto y1 = std::min(y0 + tile_size, height);
+
+      tile_segments.clear();
+      for (const auto& s : segments) {
+        const auto margin = s.radius + 1.0f;
+        if ((std::max(s.a.x, s.b.x) + margin < x0) ||
+            (std::min(s.a.x, s.b.x) - margin > x1) ||
+            (std::max(s.a.y, s.b.y) + margin < y0) ||
+            (std::min(s.a.y, s.b.y) - margin > y1))
+          continue;
+        tile_segments.push_back(&s);
+      }
+
+      for (auto y = y0; y < y1; ++y) {
+        for (auto x = x0; x < x1; ++x) {
+          const vec2 pixel{x + 0.5f, y + 0.5f};
+          auto color = shade(cam.primary_ray(pixel.x, pixel.y));
+
+          // Curves are blended one after another in their given order.
+          // Segments of the same curve do not blend with each other.
+          for (size_t i = 0; i < tile_segments.size();) {
+            const auto curve = tile_segments[i]->curve;
+            float32 coverage = 0;
+            for (; (i < tile_segments.size()) &&
+                   (tile_segments[i]->curve == curve);
+                 ++i) {
+              const auto& s = *tile_segments[i];
+              coverage = std::max(
+                  coverage, std::clamp(s.radius + 0.5f -
+                                           distance(pixel, s.a, s.b),
+                                       0.0f, 1.0f));
+            }
+            const auto& c = settings.curves[curve].color;
+            color = mix(color, vec3{c}, c.w * coverage);
+          }
+
+          auto& result = image(x, y);
+          for (int k = 0; k < 3; ++k)
+            result[k] = uint8(std::clamp(color[k], 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+      }
+    }
+  });
+  return image;
+}
+
+}  // namespace
+
+auto fitting_camera(const aabb3& box,
+                    int width,
+                    int height,
+                    const vec3& direction,
+                    const vec3& up) -> camera {
+  camera cam{};
+  cam.set_screen_resolution(width, height);
+  const auto fov = std::min(cam.vfov(), cam.hfov());
+  const auto radius = box.radius() / tan(0.5f * fov);
+  cam.move(box.origin() - radius * normalize(direction))
+      .look_at(box.origin(), up)
+      .set_near_and_far(1e-4f * radius, 2 * radius);
+  return cam;
+}
+
+auto render(const camera& cam,
+            const bvh& tree,
+            span<const polyhedral_surface::vertex> vertices,
+            span<const polyhedral_surface::face> faces,
+            const render_settings& settings) -> rgb_image {
+  return render_with(
+      cam, [&](const ray& r) { return intersection(r, tree); }, vertices,
+      faces, settings);
+}
+
+auto render(const camera& cam,
+            const compressed_bvh& tree,
+            span<const polyhedral_surface::vertex> vertices,
+            span<const polyhedral_surface::face> faces,
+            const render_settings& settings) -> rgb_image {
+  return render_with(
+      cam, [&](const ray& r) { return intersection(r, tree, vertices, faces); },
+      vertices, faces, settings);
+}
+
+}  // namespace hyperreflex
@@ -0,0 +1,98 @@
+#pragma once
+#include <hyperreflex/camera.hpp>
+#include <hyperreflex/compressed_bvh.hpp>
+
+namespace hyperreflex {
+
+/// Image with 8-bit RGB colors stored row by row from the top-left corner.
+///
+struct rgb_image {
+  using pixel = array<uint8, 3>;
+
+  rgb_image() = default;
+  rgb_image(size_t width, size_t height)
+      : width{width}, height{height}, pixels(width * height) {}
+
+  auto operator()(size_t x, size_t y) noexcept -> pixel& {
+    return pixels[y * width + x];
+  }
+  auto operator()(size_t x, size_t y) const noexcept -> const pixel& {
+    return pixels[y * width + x];
+  }
+
+  size_t width{};
+  size_t height{};
+  vector<pixel> pixels{};
+};
+
+/// Write an image as binary PPM file.
+///
+void save_ppm_file(const rgb_image& image, const filesystem::path& path);
+
+/// Write an image in the format given by the file extension.
+/// PPM files are written directly and all other formats,
+/// such as PNG, are encoded by SFML.
+///
+void save_image_file(const rgb_image& image, const filesystem::path& path);
+
+/// Polyline that is drawn on top of the surface
+/// like the lines of the viewer without depth test.
+///
+struct render_curve {
+  span<const vec3> points{};
+  vec4 color{1.0f, 0.7f, 0.3f, 1.0f};
+  // Line width in pixels
+  float32 width = 4.0f;
+};
+
+/// Options of the software renderer.
+/// The defaults resemble the heat shader of the viewer.
+///
+struct render_settings {
+  // Heat values of all vertices which are shown by the heat colormap
+  // if lighting is disabled. Without them, a heat of zero is used.
+  span<const float32> heat{};
+  span<const render_curve> curves{};
+  bool lighting = true;
+  // Draw the edges of all faces as thin lines.
+  bool edges = true;
+  vec3 background{1.0f, 1.0f, 1.0f};
+  // Side length of the square tiles in pixels
+  // that are distributed over all threads
+  size_t tile_size = 32;
+};
+
+/// Colormap of the heat shader for values in '[0, 1]'.
+///
+auto heat_color(float32 x) noexcept -> vec3;
+
+/// Camera that sees the whole box from the given view direction
+/// like the initial view of the viewer.
+///
+auto fitting_camera(const aabb3& box,
+                    int width,
+                    int height,
+                    const vec3& direction = {0, 0, -1},
+                    const vec3& up = {0, 1, 0}) -> camera;
+
+/// Render the surface seen by the camera with one primary ray per pixel
+/// and a resolution given by the camera's screen size.
+/// The BVH has to be built or refitted for the given vertices.
+/// No OpenGL context is needed.
+///
+auto render(const camera& cam,
+            const bvh& tree,
+            span<const polyhedral_surface::vertex> vertices,
+            span<const polyhedral_surface::face> faces,
+            const render_settings& settings = {}) -> rgb_image;
+
+/// Render the surface by the compressed BVH which needs less memory.
+/// The BVH has to be built for the given vertices and faces.
+///
+auto render(const camera& cam,
+            const compressed_bvh& tree,
+            span<const polyhedral_surface::vertex> vertices,
+            span<const polyhedral_surface::face> faces,
+            const render_settings& settings = {}) -> rgb_image;
+
+}  // namespace hyperreflex
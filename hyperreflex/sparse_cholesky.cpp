@@ -0,0 +1,535 @@
+#include <hyperreflex/sparse_cholesky.hpp>
+//
+#include <Eigen/Dense>
+#include <Eigen/OrderingMethods>
+//
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+namespace hyperreflex {
+
+namespace {
+
+using index_type = cholesky_analysis::index_type;
+
+template <typename real>
+using dense_matrix = Eigen::Matrix<real, Eigen::Dynamic, Eigen::Dynamic>;
+
+// Values of the factor and the solution decay quickly
+// with the distance to their sources in the elimination tree.
+// Far away, they become subnormal and do not contribute anymore.
+// On x86, arithmetic with subnormal numbers is very slow.
+// So, they are flushed to zero while this guard exists.
+//
+class subnormals_flushed_to_zero {
+ public:
+#if defined(__SSE__) || defined(_M_X64)
+  // Flush-to-zero and denormals-are-zero flags of the MXCSR register
+  static constexpr unsigned int flags = 0x8040;
+
+  subnormals_flushed_to_zero() noexcept : state{_mm_getcsr()} {
+    _mm_setcsr(state | flags);
+  }
+  ~subnormals_flushed_to_zero() noexcept { _mm_setcsr(state); }
+
+ private:
+  unsigned int state;
+#endif
+};
+
+// Lists of indices stored back to back
+//
+struct index_lists {
+  auto operator[](size_t i) const noexcept {
+    return span{indices.data() + offsets[i], indices.data() + offsets[i + 1]};
+  }
+
+  vector<index_type> offsets{};
+  vector<index_type> indices{};
+};
+
+// Group the values by their keys in '[0, count)' by counting sort.
+//
+auto index_lists_from(size_t count,
+                      span<const pair<index_type, index_type>> entries,
+                      auto key,
+                      auto value) {
+  index_lists result{};
+  result.offsets.assign(count + 1, 0);
+  for (const auto& x : entries) ++result.offsets[key(x) + 1];
+  partial_sum(begin(result.offsets), end(result.offsets),
+              begin(result.offsets));
+  auto positions = result.offsets;
+  result.indices.resize(entries.size());
+  for (const auto& x : entries) result.indices[positions[key(x)]++] = value(x);
+  return result;
+}
+
+// Row and column of all entries of 'P A P^T' below the diagonal
+//
+template <typename real>
+auto permuted_lower_entries(const Eigen::SparseMatrix<real>& matrix,
+                            span<const index_type> permutation) {
+  vector<pair<index_type, index_type>> result{};
+  for (index_type j = 0; j < matrix.outerSize(); ++j) {
+    for (typename Eigen::SparseMatrix<real>::InnerIterator it(matrix, j); it;
+         ++it) {
+      if (it.row() <= j) continue;
+      const auto p = permutation[it.row()];
+      const auto q = permutation[j];
+      result.emplace_back(std::max(p, q), std::min(p, q));
+    }
+  }
+  return result;
+}
+
+// Elimination tree by the algorithm of Liu with path compression.
+// Roots have no parent and are marked by '-1'.
+//
+auto elimination_tree(const index_lists& row_patterns) {
+  const auto n = index_type(row_patterns.offsets.size() - 1);
+  vector<index_type> parents(n, -1);
+  vector<index_type> ancestors(n, -1);
+  for (index_type k = 0; k < n; ++k) {
+    for (auto i : row_patterns[k]) {
+      while ((i != -1) && (i < k)) {
+        const auto next = ancestors[i];
+        ancestors[i] = k;
+        if (next == -1) parents[i] = k;
+        i = next;
+      }
+    }
+  }
+  return parents;
+}
+
+// Number of entries in every column of 'L' including its diagonal.
+// The pattern of row 'k' of 'L' is the union of the paths
+// in the elimination tree from the entries of row 'k' of 'A' to 'k'.
+//
+auto column_counts(const index_lists& row_patterns,
+                   span<const index_type> parents) {
+  const auto n = index_type(parents.size());
+  vector<index_type> counts(n, 1);
+  vector<index_type> marks(n, -1);
+  for (index_type k = 0; k < n; ++k) {
+    marks[k] = k;
+    for (auto j : row_patterns[k]) {
+      for (; marks[j] != k; j = parents[j]) {
+        ++counts[j];
+        marks[j] = k;
+      }
+    }
+  }
+  return counts;
+}
+
+// Fundamental supernodes consist of chains of columns
+// where every column is the only child of its successor
+// and has the same pattern below the successor.
+// Afterwards, children are merged into their parents
+// if the additional zeros are a small part of their values.
+// The thresholds are the ones used by CHOLMOD.
+//
+auto supernodes_from(span<const index_type> parents,
+                     span<const index_type> counts) {
+  const auto n = index_type(parents.size());
+  vector<index_type> children(n, 0);
+  for (auto p : parents)
+    if (p != -1) ++children[p];
+
+  vector<index_type> fundamental{0};
+  for (index_type j = 1; j < n; ++j) {
+    if ((parents[j - 1] != j) || (counts[j - 1] != counts[j] + 1) ||
+        (children[j] != 1))
+      fundamental.push_back(j);
+  }
+  fundamental.push_back(n);
+
+  // Number of values of a dense supernode with the given number of columns
+  // whose first column has 'count' entries
+  //
+  const auto values = [](float64 columns, float64 count) {
+    return columns * count - columns * (columns - 1) / 2;
+  };
+  vector<index_type> result{0};
+  float64 columns = 0;
+  float64 count = 0;
+  float64 zeros = 0;
+  for (size_t s = 0; s + 1 < fundamental.size(); ++s) {
+    const auto first = fundamental[s];
+    const float64 next_columns = fundamental[s + 1] - first;
+    const float64 next_count = counts[first];
+    if ((s > 0) && (parents[first - 1] == first)) {
+      const auto merged_columns = columns + next_columns;
+      const auto merged_count = columns + next_count;
+      const auto merged_values = values(merged_columns, merged_count);
+      const auto merged_zeros = merged_values - values(columns, count) +
+                                zeros - values(next_columns, next_count);
+      const auto fraction = merged_zeros / merged_values;
+      if ((merged_columns <= 4) ||
+          ((merged_columns <= 16) && (fraction < 0.8)) ||
+          ((merged_columns <= 48) && (fraction < 0.1)) || (fraction < 0.05)) {
+        columns = merged_columns;
+        count = merged_count;
+        zeros = merged_zeros;
+        continue;
+      }
+    }
+    if (s > 0) result.push_back(first);
+    columns = next_columns;
+    count = next_count;
+    zeros = 0;
+  }
+  if (n > 0) result.push_back(n);
+  return result;
+}
+
+auto supernodes_of_columns(const cholesky_analysis& analysis) {
+  vector<index_type> result(analysis.size());
+  for (size_t s = 0; s < analysis.supernode_count(); ++s)
+    fill(begin(result) + analysis.supernodes[s],
+         begin(result) + analysis.supernodes[s + 1], index_type(s));
+  return result;
+}
+
+auto rows_of(const cholesky_analysis& analysis, size_t s) noexcept {
+  return span{analysis.rows.data() + analysis.row_offsets[s],
+              analysis.rows.data() + analysis.row_offsets[s + 1]};
+}
+
+// Largest number of rows below the diagonal block of a supernode
+//
+auto max_update_size(const cholesky_analysis& analysis) noexcept {
+  size_t result = 0;
+  for (size_t s = 0; s < analysis.supernode_count(); ++s)
+    result = std::max(result, size_t(analysis.row_offsets[s + 1] -
+                                     analysis.row_offsets[s] -
+                                     analysis.supernodes[s + 1] +
+                                     analysis.supernodes[s]));
+  return result;
+}
+
+}  // namespace
+
+template <typename real>
+auto cholesky_analysis_from(const Eigen::SparseMatrix<real>& matrix)
+    -> cholesky_analysis {
+  const auto n = size_t(matrix.cols());
+  if (size_t(matrix.rows()) != n)
+    throw invalid_argument("Failed to analyze matrix as it is not square.");
+
+  cholesky_analysis result{};
+  {
+    const Eigen::SparseMatrix<real> symmetric =
+        matrix.template selfadjointView<Eigen::Lower>();
+    Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, index_type>
+        inverse{};
+    Eigen::AMDOrdering<index_type>{}(symmetric, inverse);
+    const Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, index_type>
+        permutation = inverse.inverse();
+    const auto& p = permutation.indices();
+    result.permutation.assign(p.data(), p.data() + p.size());
+  }
+
+  const auto entries = permuted_lower_entries(matrix, result.permutation);
+  const auto row_patterns = index_lists_from(
+      n, entries, [](auto& x) { return x.first; },
+      [](auto& x) { return x.second; });
+  const auto column_patterns = index_lists_from(
+      n, entries, [](auto& x) { return x.second; },
+      [](auto& x) { return x.first; });
+  const auto parents = elimination_tree(row_patterns);
+  const auto counts = column_counts(row_patterns, parents);
+  result.supernodes = supernodes_from(parents, counts);
+
+  // The pattern of a supernode is the union of the patterns of its columns
+  // in 'A' and the patterns of its children below their own columns.
+  //
+  const auto supernode_count = index_type(result.supernode_count());
+  const auto supernode_of = supernodes_of_columns(result);
+  vector<pair<index_type, index_type>> tree{};
+  for (index_type s = 0; s < supernode_count; ++s) {
+    const auto p = parents[result.supernodes[s + 1] - 1];
+    if (p != -1) tree.emplace_back(supernode_of[p], s);
+  }
+  const auto children = index_lists_from(
+      supernode_count, tree, [](auto& x) { return x.first; },
+      [](auto& x) { return x.second; });
+
+  vector<index_type> marks(n, -1);
+  result.row_offsets.assign(1, 0);
+  result.value_offsets.assign(1, 0);
+  for (index_type s = 0; s < supernode_count; ++s) {
+    const auto first = result.supernodes[s];
+    const auto last = result.supernodes[s + 1];
+    for (auto j = first; j < last; ++j) result.rows.push_back(j);
+    const auto below = result.rows.size();
+    const auto add = [&](index_type i) {
+      if ((i < last) || (marks[i] == s)) return;
+      marks[i] = s;
+      result.rows.push_back(i);
+    };
+    for (auto j = first; j < last; ++j)
+      for (auto i : column_patterns[j]) add(i);
+    // Adding rows may reallocate them.
+    // So, the rows of the children are accessed by their indices.
+    for (auto c : children[s])
+      for (auto k = result.row_offsets[c]; k < result.row_offsets[c + 1]; ++k)
+        add(result.rows[k]);
+    sort(begin(result.rows) + below, end(result.rows));
+    result.row_offsets.push_back(result.rows.size());
+    result.value_offsets.push_back(
+        result.value_offsets.back() +
+        uint64(result.row_offsets[s + 1] - result.row_offsets[s]) *
+            (last - first));
+  }
+  return result;
+}
+
+template <typename real>
+auto cholesky_factor_from(const cholesky_analysis& analysis,
+                          const Eigen::SparseMatrix<real>& matrix)
+    -> cholesky_factor<real> {
+  const auto n = analysis.size();
+  if ((size_t(matrix.rows()) != n) || (size_t(matrix.cols()) != n))
+    throw invalid_argument(
+        "Failed to factorize matrix as its size differs from the analysis.");
+  const auto pattern_error = [] {
+    return runtime_error(
+        "Failed to factorize matrix as its pattern differs from the "
+        "analysis.");
+  };
+  // Position of a row in the sorted rows of a supernode
+  //
+  const auto find = [&](span<const index_type> rows, auto first, auto row) {
+    const auto p = lower_bound(first, rows.end(), row);
+    if ((p == rows.end()) || (*p != row)) throw pattern_error();
+    return p;
+  };
+
+  const auto& supernodes = analysis.supernodes;
+  const auto supernode_of = supernodes_of_columns(analysis);
+  cholesky_factor<real> result{};
+  result.values.assign(analysis.value_count(), 0);
+  const auto block_of = [&](size_t s) {
+    const auto rows = rows_of(analysis, s);
+    return Eigen::Map<dense_matrix<real>>(
+        result.values.data() + analysis.value_offsets[s], rows.size(),
+        supernodes[s + 1] - supernodes[s]);
+  };
+
+  // Scatter the lower triangle of 'P A P^T' into the blocks.
+  //
+  for (index_type j = 0; j < matrix.outerSize(); ++j) {
+    for (typename Eigen::SparseMatrix<real>::InnerIterator it(matrix, j); it;
+         ++it) {
+      if (it.row() < j) continue;
+      const auto p = analysis.permutation[it.row()];
+      const auto q = analysis.permutation[j];
+      const auto row = std::max(p, q);
+      const auto column = std::min(p, q);
+      const auto s = supernode_of[column];
+      const auto rows = rows_of(analysis, s);
+      const auto i = find(rows, rows.begin(), row) - rows.begin();
+      block_of(s)(i, column - supernodes[s]) += it.value();
+    }
+  }
+
+  const subnormals_flushed_to_zero flushed{};
+
+  // Right-looking factorization by supernodes.
+  // Every supernode is factorized by dense kernels
+  // and its update is subtracted from the supernodes of its rows.
+  //
+  const auto max_size = max_update_size(analysis);
+  vector<real> update(max_size * max_size);
+  vector<size_t> relative(max_size);
+  for (size_t s = 0; s < analysis.supernode_count(); ++s) {
+    const auto rows = rows_of(analysis, s);
+    const auto columns = supernodes[s + 1] - supernodes[s];
+    const auto m = rows.size() - columns;
+    auto block = block_of(s);
+
+    Eigen::Ref<dense_matrix<real>> diagonal = block.topRows(columns);
+    const Eigen::LLT<Eigen::Ref<dense_matrix<real>>> llt{diagonal};
+    if (llt.info() != Eigen::Success)
+      throw runtime_error(
+          "Failed to factorize matrix as it is not positive definite.");
+    if (m == 0) continue;
+    auto lower = block.bottomRows(m);
+    diagonal.template triangularView<Eigen::Lower>()
+        .transpose()
+        .template solveInPlace<Eigen::OnTheRight>(lower);
+
+    Eigen::Map<dense_matrix<real>> u(update.data(), m, m);
+    u.template triangularView<Eigen::Lower>() = lower * lower.transpose();
+
+    // The rows of the update that belong to the columns of one supernode
+    // are consecutive. All its rows are part of this supernode's rows.
+    //
+    const auto update_rows = rows.subspan(columns);
+    for (size_t k = 0; k < m;) {
+      const auto t = supernode_of[update_rows[k]];
+      const auto target_rows = rows_of(analysis, t);
+      auto target = block_of(t);
+      auto position = target_rows.begin();
+      for (auto i = k; i < m; ++i) {
+        position = find(target_rows, position, update_rows[i]);
+        relative[i] = position - target_rows.begin();
+      }
+      for (; (k < m) && (update_rows[k] < supernodes[t + 1]); ++k) {
+        const auto column = update_rows[k] - supernodes[t];
+        for (auto i = k; i < m; ++i) target(relative[i], column) -= u(i, k);
+      }
+    }
+  }
+  return result;
+}
+
+template <typename real>
+void solve(const cholesky_analysis& analysis,
+           const cholesky_factor<real>& factor,
+           span<real> x) {
+  const auto n = analysis.size();
+  assert(x.size() == n);
+  const auto& supernodes = analysis.supernodes;
+
+  const subnormals_flushed_to_zero flushed{};
+  vector<real> y(n);
+  for (size_t i = 0; i < n; ++i) y[analysis.permutation[i]] = x[i];
+  vector<real> work(max_update_size(analysis));
+
+  // Forward substitution with 'L' by supernodes.
+  // The columns of a block are traversed one after another
+  // such that the values are read contiguously.
+  //
+  for (size_t s = 0; s < analysis.supernode_count(); ++s) {
+    const auto rows = rows_of(analysis, s);
+    const size_t columns = supernodes[s + 1] - supernodes[s];
+    const auto m = rows.size() - columns;
+    const auto block = factor.values.data() + analysis.value_offsets[s];
+    const auto z = y.data() + supernodes[s];
+    // Right-hand sides with only a few nonzeros, like point sources,
+    // only reach the supernodes on their paths to the root.
+    // All other blocks would only add zeros.
+    if (all_of(z, z + columns, [](real x) { return x == 0; })) continue;
+    const auto w = work.data();
+    fill_n(w, m, real(0));
+    for (size_t j = 0; j < columns; ++j) {
+      const auto column = block + j * rows.size();
+      const auto zj = z[j] /= column[j];
+      for (auto i = j + 1; i < columns; ++i) z[i] -= column[i] * zj;
+      for (size_t k = 0; k < m; ++k) w[k] += column[columns + k] * zj;
+    }
+    for (size_t k = 0; k < m; ++k) y[rows[columns + k]] -= w[k];
+  }
+  // Backward substitution with the transpose of 'L' by supernodes
+  //
+  for (auto s = analysis.supernode_count(); s-- > 0;) {
+    const auto rows = rows_of(analysis, s);
+    const size_t columns = supernodes[s + 1] - supernodes[s];
+    const auto m = rows.size() - columns;
+    const auto block = factor.values.data() + analysis.value_offsets[s];
+    const auto z = y.data() + supernodes[s];
+    const auto w = work.data();
+    for (size_t k = 0; k < m; ++k) w[k] = y[rows[columns + k]];
+    for (auto j = columns; j-- > 0;) {
+      const auto column = block + j * rows.size();
+      auto sum = z[j];
+      for (auto i = j + 1; i < columns; ++i) sum -= column[i] * z[i];
+      for (size_t k = 0; k < m; ++k) sum -= column[columns + k] * w[k];
+      z[j] = sum / column[j];
+    }
+  }
+
+  for (size_t i = 0; i < n; ++i) x[i] = y[analysis.permutation[i]];
+}
+
+template <typename real>
+void solve(const cholesky_analysis& analysis,
+           const cholesky_factor<real>& factor,
+           span<real> x,
+           size_t count) {
+  const auto n = analysis.size();
+  assert(x.size() == n * count);
+  const auto& supernodes = analysis.supernodes;
+
+  const subnormals_flushed_to_zero flushed{};
+  dense_matrix<real> y(n, count);
+  for (size_t j = 0; j < count; ++j)
+    for (size_t i = 0; i < n; ++i) y(analysis.permutation[i], j) = x[j * n + i];
+  dense_matrix<real> work(max_update_size(analysis), count);
+  const auto block_of = [&](size_t s) {
+    return Eigen::Map<const dense_matrix<real>>(
+        factor.values.data() + analysis.value_offsets[s],
+        rows_of(analysis, s).size(), supernodes[s + 1] - supernodes[s]);
+  };
+
+  // Forward substitution with 'L' by supernodes
+  //
+  for (size_t s = 0; s < analysis.supernode_count(); ++s) {
+    const auto rows = rows_of(analysis, s);
+    const size_t columns = supernodes[s + 1] - supernodes[s];
+    const auto m = rows.size() - columns;
+    const auto block = block_of(s);
+    auto z = y.middleRows(supernodes[s], columns);
+    if ((z.array() == 0).all()) continue;
+    block.topRows(columns)
+        .template triangularView<Eigen::Lower>()
+        .solveInPlace(z);
+    if (m == 0) continue;
+    auto w = work.topRows(m);
+    w.noalias() = block.bottomRows(m) * z;
+    for (size_t k = 0; k < m; ++k) y.row(rows[columns + k]) -= w.row(k);
+  }
+  // Backward substitution with the transpose of 'L' by supernodes
+  //
+  for (auto s = analysis.supernode_count(); s-- > 0;) {
+    const auto rows = rows_of(analysis, s);
+    const size_t columns = supernodes[s + 1] - supernodes[s];
+    const auto m = rows.size() - columns;
+    const auto block = block_of(s);
+    auto z = y.middleRows(supernodes[s], columns);
+    if (m > 0) {
+      auto w = work.topRows(m);
+      for (size_t k = 0; k < m; ++k) w.row(k) = y.row(rows[columns + k]);
+      z.noalias() -= block.bottomRows(m).transpose() * w;
+    }
+    block.topRows(columns)
+        .template triangularView<Eigen::Lower>()
+        .transpose()
+        .solveInPlace(z);
+  }
+
+  for (size_t j = 0; j < count; ++j)
+    for (size_t i = 0; i < n; ++i) x[j * n + i] = y(analysis.permutation[i], j);
+}
+
+template auto cholesky_analysis_from(const Eigen::SparseMatrix<float32>&)
+    -> cholesky_analysis;
+template auto cholesky_analysis_from(const Eigen::SparseMatrix<float64>&)
+    -> cholesky_analysis;
+template auto cholesky_factor_from(const cholesky_analysis&,
+                                   const Eigen::SparseMatrix<float32>&)
+    -> cholesky_factor<float32>;
+template auto cholesky_factor_from(const cholesky_analysis&,
+                                   const Eigen::SparseMatrix<float64>&)
+    -> cholesky_factor<float64>;
+template void solve(const cholesky_analysis&,
+                    const cholesky_factor<float32>&,
+                    span<float32>);
+template void solve(const cholesky_analysis&,
+                    const cholesky_factor<float64>&,
+                    span<float64>);
+template void solve(const cholesky_analysis&,
+                    const cholesky_factor<float32>&,
+                    span<float32>,
+                    size_t);
+template void solve(const cholesky_analysis&,
+                    const cholesky_factor<float64>&,
+                    span<float64>,
+                    size_t);
+
+}  // namespace hyperreflex
@@ -0,0 +1,91 @@
+#pragma once
+#include <hyperreflex/utility.hpp>
+//
+#include <Eigen/Sparse>
+
+namespace hyperreflex {
+
+/// Symbolic analysis of the sparse Cholesky factorization 'P A P^T = L L^T'
+/// of a symmetric positive-definite matrix 'A'.
+/// It only depends on the sparsity pattern of 'A'.
+/// So, it can be reused for all matrices with the same pattern,
+/// for example, when only the vertex positions of a surface change.
+/// Consecutive columns of 'L' with nested row patterns are grouped
+/// into supernodes whose values form dense column-major blocks.
+/// Zeros are explicitly stored if this makes supernodes much larger.
+/// The factorization and solves can then use dense matrix kernels.
+///
+struct cholesky_analysis {
+  using index_type = int32;
+
+  auto size() const noexcept { return permutation.size(); }
+  auto supernode_count() const noexcept {
+    return supernodes.empty() ? 0 : supernodes.size() - 1;
+  }
+  auto value_count() const noexcept {
+    return value_offsets.empty() ? 0 : size_t(value_offsets.back());
+  }
+
+  // Row 'i' of 'A' is row 'permutation[i]' of 'P A P^T'.
+  vector<index_type> permutation{};
+  // Supernode 's' consists of the columns '[supernodes[s], supernodes[s+1])'.
+  vector<index_type> supernodes{};
+  // Sorted rows of every supernode which start with its own columns.
+  // The rows of supernode 's' are '[row_offsets[s], row_offsets[s+1])'.
+  vector<index_type> row_offsets{};
+  vector<index_type> rows{};
+  // Offset of every supernode's dense block in the values of the factor
+  vector<uint64> value_offsets{};
+};
+
+/// Compute a fill-reducing ordering of the rows and columns
+/// by approximate minimum degree and the supernodes of the factor.
+/// Only the pattern of the lower triangle of the matrix is used.
+///
+template <typename real>
+auto cholesky_analysis_from(const Eigen::SparseMatrix<real>& matrix)
+    -> cholesky_analysis;
+
+/// Numerical values of the factor 'L' for a given symbolic analysis.
+/// The block of supernode 's' has as many rows as the supernode
+/// and as many columns as the supernode has columns.
+///
+template <typename real>
+struct cholesky_factor {
+  using real_type = real;
+  vector<real> values{};
+};
+
+/// Factorize a symmetric positive-definite matrix
+/// whose lower triangle has the pattern of the analysis.
+/// Only the lower triangle of the matrix is used.
+/// Throws if the matrix is not positive definite
+/// or has entries outside of the analyzed pattern.
+///
+template <typename real>
+auto cholesky_factor_from(const cholesky_analysis& analysis,
+                          const Eigen::SparseMatrix<real>& matrix)
+    -> cholesky_factor<real>;
+
+/// Solve 'A x = b' in place where 'x' is given as 'b'.
+/// The forward substitution skips all supernodes
+/// that are not reached by the nonzeros of 'b'.
+/// So, sparse right-hand sides are solved faster.
+///
+template <typename real>
+void solve(const cholesky_analysis& analysis,
+           const cholesky_factor<real>& factor,
+           span<real> x);
+
+/// Solve 'A X = B' in place for 'count' right-hand sides at once
+/// where 'X' is given as 'B' and stored column-major in 'x'.
+/// Every supernode is applied to all columns by dense matrix kernels.
+/// This is much faster than solving for the columns one by one.
+///
+template <typename real>
+void solve(const cholesky_analysis& analysis,
+           const cholesky_factor<real>& factor,
+           span<real> x,
+           size_t count);
+
+}  // namespace hyperreflex
@@ -0,0 +1,92 @@
+#include <hyperreflex/sparse_cholesky.hpp>
+//
+#include <Eigen/Dense>
+//
+#include <random>
+
+using namespace hyperreflex;
+
+namespace {
+
+mt19937 rng{12345};
+
+// Random sparse symmetric matrix which is made positive definite
+// by strict diagonal dominance
+//
+auto random_spd_matrix(int n, float64 density) {
+  uniform_real_distribution<float64> value(-1, 1);
+  bernoulli_distribution nonzero(density);
+  vector<Eigen::Triplet<float64>> entries{};
+  vector<float64> sums(n, 0);
+  for (int j = 0; j < n; ++j) {
+    for (int i = j + 1; i < n; ++i) {
+      if (!nonzero(rng)) continue;
+      const auto x = value(rng);
+      entries.emplace_back(i, j, x);
+      entries.emplace_back(j, i, x);
+      sums[i] += abs(x);
+      sums[j] += abs(x);
+    }
+  }
+  for (int i = 0; i < n; ++i) entries.emplace_back(i, i, sums[i] + 1);
+  Eigen::SparseMatrix<float64> result(n, n);
+  result.setFromTriplets(begin(entries), end(entries));
+  return result;
+}
+
+auto max_difference(span<const float64> x, const Eigen::VectorXd& y) {
+  float64 result = 0;
+  for (size_t i = 0; i < x.size(); ++i)
+    result = std::max(result, abs(x[i] - y[i]));
+  return result;
+}
+
+}  // namespace
+
+// Solve random systems with the sparse factorization
+// and compare the solutions to the ones of a dense factorization.
+//
+int main() {
+  constexpr float64 tolerance = 1e-10;
+  int failures = 0;
+  const auto check = [&](bool success, czstring message, int n,
+                         float64 density) {
+    if (success) return;
+    cerr << "FAILED: " << message << " (n = " << n
+         << ", density = " << density << ")\n";
+    ++failures;
+  };
+
+  for (int n : {1, 2, 5, 17, 64, 200, 500}) {
+    for (float64 density : {0.0, 0.01, 0.05, 0.2, 1.0}) {
+      const auto matrix = random_spd_matrix(n, density);
+      const auto analysis = cholesky_analysis_from(matrix);
+      const auto factor = cholesky_factor_from(analysis, matrix);
+      const Eigen::LLT<Eigen::MatrixXd> dense{Eigen::MatrixXd(matrix)};
+
+      constexpr size_t count = 5;
+      uniform_real_distribution<float64> value(-1, 1);
+      vector<float64> b(n * count);
+      for (auto& x : b) x = value(rng);
+      // The last right-hand side is a point source.
+      fill_n(begin(b) + (count - 1) * n, n, 0.0);
+      b[(count - 1) * n + n / 2] = 1;
+
+      auto batched = b;
+      solve(analysis, factor, span{batched}, count);
+      for (size_t j = 0; j < count; ++j) {
+        const auto column = span{b}.subspan(j * n, n);
+        const Eigen::VectorXd expected =
+            dense.solve(Eigen::Map<const Eigen::VectorXd>(column.data(), n));
+        vector<float64> x(begin(column), end(column));
+        solve(analysis, factor, span{x});
+        check(max_difference(x, expected) < tolerance,
+              "single solve differs from dense solve", n, density);
+        check(max_difference(span{batched}.subspan(j * n, n), expected) <
+                  tolerance,
+              "batched solve differs from dense solve", n, density);
+      }
+    }
+  }
+  return failures ? 1 : 0;
+}
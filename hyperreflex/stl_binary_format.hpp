@@ -1,5 +1,5 @@
 #pragma once
-#include <hyperreflex/utility.hpp>
+#include <hyperreflex/stl_binary_view.hpp>
 
 namespace hyperreflex {
 
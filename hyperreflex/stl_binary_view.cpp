@@ -0,0 +1,52 @@
+#include <hyperreflex/stl_binary_view.hpp>
+
+namespace hyperreflex {
+
+stl_binary_view::stl_binary_view(const filesystem::path& path) : file{path} {
+  const auto throw_error = [&](czstring str) {
+    throw runtime_error("Failed to read binary STL file from path '"s +
+                        path.string() + "'. " + str);
+  };
+
+  if (file.size() < offset) throw_error("The file is too small for a header.");
+
+  // Read number of triangles.
+  memcpy(&count, file.data() + header_size, sizeof(count));
+
+  // Every record will be accessed in place.
+  // So, the file must provide all of them.
+  if (!consistent(file.size(), count))
+    throw_error("The file is too small for the given number of triangles.");
+}
+
+void stl_binary_view::decode(const char* records,
+                             size_t count,
+                             void* out) noexcept {
+  // Every record consists of a packed 48-byte triangle
+  // followed by the two-byte attribute count which is skipped.
+  // The fixed-size copy is compiled into a few unaligned wide loads and stores.
+  auto dst = static_cast<char*>(out);
+  for (size_t i = 0; i < count; ++i) {
+    memcpy(dst, records, triangle_size);
+    dst += triangle_size;
+    records += stride;
+  }
+}
+
+void stl_binary_view::decode(size_type first,
+                             size_type last,
+                             vec3* positions,
+                             vec3* normals) const noexcept {
+  assert(first <= last);
+  assert(last <= count);
+  static_assert(sizeof(vec3) == 3 * sizeof(float32));
+  auto src = record(first);
+  for (auto i = first; i < last; ++i) {
+    memcpy(normals++, src, sizeof(vec3));
+    memcpy(positions, src + sizeof(vec3), 3 * sizeof(vec3));
+    positions += 3;
+    src += stride;
+  }
+}
+
+}  // namespace hyperreflex
@@ -0,0 +1,100 @@
+#pragma once
+#include <hyperreflex/memory_mapped_file.hpp>
+
+namespace hyperreflex {
+
+// Zero-copy access to the triangle records of a binary STL file.
+// The file is memory-mapped and every record is read in place.
+// Records are 50 bytes wide and therefore not aligned for 'float32'.
+// Hence, all accessors decode through 'memcpy' which the compiler
+// lowers to unaligned vector loads.
+//
+struct stl_binary_view {
+  using header = array<uint8, 80>;
+  using size_type = uint32;
+  using attribute_byte_count_type = uint16;
+
+  static constexpr size_t header_size = sizeof(header);
+  static constexpr size_t offset = header_size + sizeof(size_type);
+  static constexpr size_t triangle_size = 12 * sizeof(float32);
+  static constexpr size_t stride =
+      triangle_size + sizeof(attribute_byte_count_type);
+
+  static_assert(endian::native == endian::little,
+                "Binary STL files are stored in little-endian byte order.");
+
+  // Checks whether a file of the given size could contain
+  // the given number of triangle records.
+  //
+  static constexpr auto consistent(size_t file_size, size_type count) noexcept {
+    return file_size >= offset + size_t(count) * stride;
+  }
+
+  // Like 'stl_binary_format', this type represents the file itself.
+  // So, no factory function is used to construct it from a file.
+  //
+  stl_binary_view(const filesystem::path& path);
+
+  auto size() const noexcept -> size_type { return count; }
+  auto empty() const noexcept -> bool { return count == 0; }
+
+  // Raw pointer to the 50-byte record of the triangle with index 'i'.
+  //
+  auto record(size_type i) const noexcept -> const char* {
+    return file.data() + offset + size_t(i) * stride;
+  }
+
+  auto normal(size_type i) const noexcept -> vec3 {
+    vec3 result;
+    memcpy(&result, record(i), sizeof(vec3));
+    return result;
+  }
+
+  auto vertex(size_type i, size_type j) const noexcept -> vec3 {
+    vec3 result;
+    memcpy(&result, record(i) + (j + 1) * sizeof(vec3), sizeof(vec3));
+    return result;
+  }
+
+  // Bulk decode of triangles '[first, last)' into a packed array
+  // of 48-byte triangles as used by 'stl_surface' and 'stl_binary_format'.
+  //
+  template <typename triangle>
+    requires(sizeof(triangle) == triangle_size) &&
+            is_trivially_copyable_v<triangle>
+  void decode(size_type first, size_type last, triangle* out) const noexcept {
+    assert(first <= last);
+    assert(last <= count);
+    decode(record(first), last - first, out);
+  }
+
+  // Bulk decode of triangles '[first, last)' into separate streams.
+  // For every triangle, three consecutive positions
+  // and one normal are written.
+  //
+  void decode(size_type first,
+              size_type last,
+              vec3* positions,
+              vec3* normals) const noexcept;
+
+  // Bulk decode of 'count' consecutive records starting at 'records'.
+  // This is also used for blocks of records that have been read
+  // into a buffer when streaming a file.
+  //
+  template <typename triangle>
+    requires(sizeof(triangle) == triangle_size) &&
+            is_trivially_copyable_v<triangle>
+  static void decode(const char* records,
+                     size_t count,
+                     triangle* out) noexcept {
+    decode(records, count, static_cast<void*>(out));
+  }
+
+  memory_mapped_file file;
+  size_type count{};
+
+ private:
+  static void decode(const char* records, size_t count, void* out) noexcept;
+};
+
+}  // namespace hyperreflex
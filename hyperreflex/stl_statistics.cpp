@@ -0,0 +1,28 @@
+#include <hyperreflex/stl_statistics.hpp>
+
+namespace hyperreflex {
+
+void stl_statistics::insert(
+    span<const stl_surface::triangle> batch) noexcept {
+  for (const auto& t : batch) {
+    box = (triangles == 0) ? aabb_from(t.vertex[0]) : aabb(box, t.vertex[0]);
+    box = aabb(aabb(box, t.vertex[1]), t.vertex[2]);
+    ++triangles;
+    const auto a = length(cross(t.vertex[1] - t.vertex[0],  //
+                                t.vertex[2] - t.vertex[0])) /
+                   2;
+    area += a;
+    degenerate_triangles += (a == 0);
+  }
+}
+
+auto stl_statistics_from(const filesystem::path& path) -> stl_statistics {
+  stl_statistics result{};
+  stl_surface::for_each_batch(
+      path, [&](span<const stl_surface::triangle> triangles) {
+        result.insert(triangles);
+      });
+  return result;
+}
+
+}  // namespace hyperreflex
@@ -0,0 +1,24 @@
+#pragma once
+#include <hyperreflex/aabb.hpp>
+#include <hyperreflex/stl_surface.hpp>
+
+namespace hyperreflex {
+
+// Summary of the triangles of an STL file.
+// The statistics can be accumulated batch by batch.
+// So, they work for streamed files that do not fit into memory.
+//
+struct stl_statistics {
+  void insert(span<const stl_surface::triangle> triangles) noexcept;
+
+  size_t triangles{};
+  size_t degenerate_triangles{};
+  float64 area{};
+  aabb3 box{};
+};
+
+/// Stream an STL file once to compute its statistics.
+///
+auto stl_statistics_from(const filesystem::path& path) -> stl_statistics;
+
+}  // namespace hyperreflex
@@ -1,4 +1,6 @@
 #include <hyperreflex/stl_surface.hpp>
+//
+#include <hyperreflex/parallel.hpp>
 
 namespace hyperreflex {
 
@@ -11,78 +13,368 @@ void stl_surface::load_from_binary_file(const filesystem::path& path) {
   static_assert(sizeof(triangle) == 48);
   static_assert(alignof(triangle) == 4);
 
+  // The records are decoded in bulk from the memory-mapped file.
+  // Reading through 'fstream' with one call per triangle is far too slow.
+  const stl_binary_view view{path};
+  triangles.resize(view.size());
+  view.decode(0, view.size(), triangles.data());
+}
+
+namespace {
+
+// Minimal tokenizer for ASCII-based STL files which works directly
+// on the memory-mapped file content without any allocations.
+//
+struct stl_ascii_tokenizer {
+  using parser_error = stl_surface::parser_error;
+
+  static constexpr auto whitespace(char c) noexcept {
+    return (c == ' ') || (c == '\n') || (c == '\r') || (c == '\t') ||
+           (c == '\v') || (c == '\f');
+  }
+
+  void skip_whitespace() noexcept {
+    while ((it != last) && whitespace(*it)) ++it;
+  }
+
+  auto token() noexcept -> string_view {
+    skip_whitespace();
+    const auto first = it;
+    while ((it != last) && !whitespace(*it)) ++it;
+    return {first, it};
+  }
+
+  void match(string_view keyword) {
+    if (token() == keyword) return;
+    throw parser_error("Failed to match keyword '"s + string(keyword) +
+                       "' in ASCII-based STL file.");
+  }
+
+  auto number() -> float32 {
+    skip_whitespace();
+    // In contrast to stream extraction,
+    // 'from_chars' does not accept a leading plus sign.
+    if ((it != last) && (*it == '+')) ++it;
+    float32 result;
+    const auto [ptr, error] = from_chars(it, last, result);
+    if ((error != errc{}) || ((ptr != last) && !whitespace(*ptr)))
+      throw parser_error{"Failed to parse number in ASCII-based STL file."};
+    it = ptr;
+    return result;
+  }
+
+  void parse(vec3& v) {
+    v.x = number();
+    v.y = number();
+    v.z = number();
+  }
+
+  const char* it;
+  const char* last;
+};
+
+// The result of parsing a chunk of facets.
+// A chunk is terminated when the keyword 'endsolid' has been reached.
+// Errors are stored and not thrown, because errors in chunks
+// after the terminating one must be ignored.
+//
+struct stl_ascii_chunk {
+  vector<stl_surface::triangle> triangles{};
+  const char* endsolid = nullptr;
+  exception_ptr error{};
+};
+
+void parse_stl_ascii_chunk(const char* first,
+                           const char* last,
+                           const char* file_end,
+                           stl_ascii_chunk& chunk) try {
+  // Facets starting in this chunk may end in the next one.
+  // So, the tokenizer may read until the end of the file.
+  stl_ascii_tokenizer input{first, file_end};
+  chunk.triangles.reserve((last - first) / 256);
+
+  while (true) {
+    input.skip_whitespace();
+    if (input.it >= last) return;
+    const auto keyword = input.token();
+    if (keyword == "endsolid") {
+      chunk.endsolid = input.it;
+      return;
+    } else if (keyword == "facet") {
+      stl_surface::triangle t{};
+      input.match("normal");
+      input.parse(t.normal);
+      input.match("outer");
+      input.match("loop");
+      for (int i = 0; i < 3; ++i) {
+        input.match("vertex");
+        input.parse(t.vertex[i]);
+      }
+      input.match("endloop");
+      input.match("endfacet");
+      chunk.triangles.push_back(t);
+    } else
+      throw stl_surface::parser_error{
+          "Failed to match keyword 'facet' or 'endsolid'."};
+  }
+} catch (...) {
+  chunk.error = current_exception();
+}
+
+}  // namespace
+
+// The keyword 'endfacet' is no match as it is not preceded by whitespace.
+// This also holds if 'first' points to its 'f'.
+//
+auto stl_surface::next_facet(const char* first, const char* last) noexcept
+    -> const char* {
+  constexpr string_view keyword = "facet";
+  const string_view str{first, last};
+  for (auto i = str.find(keyword); i != string_view::npos;
+       i = str.find(keyword, i + 1)) {
+    const auto p = first + i;
+    if (stl_ascii_tokenizer::whitespace(p[-1]) &&
+        ((p + keyword.size() == last) ||
+         stl_ascii_tokenizer::whitespace(p[keyword.size()])))
+      return p;
+  }
+  return last;
+}
+
+void stl_surface::load_from_ascii_file(const filesystem::path& path) {
+  const memory_mapped_file file{path};
+
+  // The first line provides the keyword 'solid' and the name.
+  //
+  const auto line_end = find(file.begin(), file.end(), '\n');
+  stl_ascii_tokenizer input{file.begin(), line_end};
+  if (input.token() != "solid")
+    throw parser_error{"Failed to match keyword 'solid' at the start."};
+  const auto name = input.token();
+
+  // Reject files that are not ASCII-based early
+  // before any thread has been started.
+  //
+  input = {line_end, file.end()};
+  const auto first_keyword = input.token();
+  if ((first_keyword != "facet") && (first_keyword != "endsolid") &&
+      !first_keyword.empty())
+    throw parser_error{"Failed to match keyword 'facet' or 'endsolid'."};
+
+  // Split the facets into chunks of roughly the same size.
+  // Every chunk boundary is moved forward to the start of a facet.
+  // All boundaries lie behind the first line.
+  //
+  constexpr size_t min_chunk_size = size_t{1} << 20;
+  const auto body = line_end;
+  const size_t body_size = file.end() - body;
+  const auto chunk_count =
+      std::clamp(body_size / min_chunk_size, size_t{1}, thread_count());
+  vector<const char*> bounds(chunk_count + 1);
+  bounds.front() = body;
+  bounds.back() = file.end();
+  for (size_t i = 1; i < chunk_count; ++i)
+    bounds[i] = next_facet(
+        std::max(bounds[i - 1], body + i * body_size / chunk_count),
+        file.end());
+
+  vector<stl_ascii_chunk> chunks(chunk_count);
+  parallel_invoke(chunk_count, [&](size_t i) {
+    parse_stl_ascii_chunk(bounds[i], bounds[i + 1], file.end(), chunks[i]);
+  });
+
+  // Only chunks up to the first 'endsolid' keyword are valid.
+  // Without such a keyword, all chunks are used.
+  //
+  size_t valid_chunks = 0;
+  const char* endsolid = nullptr;
+  while (valid_chunks < chunk_count) {
+    const auto& chunk = chunks[valid_chunks++];
+    if (chunk.error) rethrow_exception(chunk.error);
+    if ((endsolid = chunk.endsolid)) break;
+  }
+  if (endsolid && !name.empty()) {
+    input = {endsolid, file.end()};
+    input.match(name);
+  }
+
+  // Join all chunks by using the prefix sum of their sizes.
+  //
+  vector<size_t> offsets(valid_chunks + 1);
+  for (size_t i = 0; i < valid_chunks; ++i)
+    offsets[i + 1] = offsets[i] + chunks[i].triangles.size();
+  const auto first = triangles.size();
+  triangles.resize(first + offsets.back());
+  parallel_invoke(valid_chunks, [&](size_t i) {
+    ranges::copy(chunks[i].triangles, &triangles[first + offsets[i]]);
+  });
+}
+
+namespace {
+
+void visit_in_batches(span<const stl_surface::triangle> triangles,
+                      const stl_surface::batch_visitor& visitor,
+                      size_t batch_size) {
+  for (size_t i = 0; i < triangles.size(); i += batch_size)
+    visitor(triangles.subspan(i, std::min(batch_size, triangles.size() - i)));
+}
+
+}  // namespace
+
+void stl_surface::for_each_binary_batch(const filesystem::path& path,
+                                        const batch_visitor& visitor,
+                                        size_t batch_size) {
   fstream file{path, ios::in | ios::binary};
   if (!file.is_open())
     throw runtime_error("Failed to open STL file from path '"s + path.string() +
                         "'.");
 
-  // We will ignore the header.
-  // It has no specific use to us.
   file.ignore(sizeof(header));
-
-  // Read number of triangles.
   size_type size;
   file.read((char*)&size, sizeof(size));
+  if (!file || !stl_binary_view::consistent(file_size(path), size))
+    throw runtime_error("Failed to read binary STL file from path '"s +
+                        path.string() +
+                        "'. The file is too small for the given number of "
+                        "triangles.");
 
-  triangles.resize(size);
-
-  // Due to padding and alignment issues concerning 'float32' and 'uint16',
-  // we cannot read everything at once.
-  // Instead, we use a simple loop for every triangle.
-  for (auto& t : triangles) {
-    file.read((char*)&t, sizeof(triangle));
-    // Ignore the attribute byte count.
-    // There should not be any information anyway.
-    file.ignore(sizeof(attribute_byte_count_type));
+  // One block of records is read with a single call
+  // and then decoded into the batch.
+  //
+  batch_size = std::max(batch_size, size_t{1});
+  vector<char> block(batch_size * stl_binary_view::stride);
+  vector<triangle> batch(batch_size);
+  for (size_t i = 0; i < size; i += batch_size) {
+    const auto count = std::min(batch_size, size - i);
+    file.read(block.data(), count * stl_binary_view::stride);
+    stl_binary_view::decode(block.data(), count, batch.data());
+    visitor({batch.data(), count});
   }
 }
 
-void stl_surface::load_from_ascii_file(const filesystem::path& path) {
+void stl_surface::for_each_ascii_batch(const filesystem::path& path,
+                                       const batch_visitor& visitor,
+                                       size_t batch_size) {
   fstream file{path, ios::in | ios::binary};
   if (!file.is_open())
     throw runtime_error("Failed to open STL file from path '"s + path.string() +
                         "'.");
+  batch_size = std::max(batch_size, size_t{1});
 
-  string name;
-  string line;
-  getline(file, line);
-  stringstream input{line};
-  string keyword;
-  input >> keyword;
-
-  const auto match = [&](czstring str) {
-    file >> keyword;
-    if (keyword == str) return;
-    throw parser_error("Failed to match keyword '"s + str +
-                       "' in ASCII-based STL file.");
+  // The buffer consists of the unparsed rest of
+  // the previous block followed by the next block.
+  //
+  constexpr size_t block_size = size_t{1} << 22;
+  vector<char> buffer{};
+  const auto read_block = [&] {
+    const auto size = buffer.size();
+    buffer.resize(size + block_size);
+    file.read(buffer.data() + size, block_size);
+    buffer.resize(size + file.gcount());
+    return !file.eof();
   };
+  auto more = read_block();
 
-  if (keyword != "solid")
+  // The first line provides the keyword 'solid' and the name.
+  //
+  const auto line_end =
+      find(buffer.data(), buffer.data() + buffer.size(), '\n');
+  stl_ascii_tokenizer input{buffer.data(), line_end};
+  if (input.token() != "solid")
     throw parser_error{"Failed to match keyword 'solid' at the start."};
-  input >> name;
+  const string name{input.token()};
+  input = {line_end, buffer.data() + buffer.size()};
+  const auto first_keyword = input.token();
+  if ((first_keyword != "facet") && (first_keyword != "endsolid") &&
+      !first_keyword.empty())
+    throw parser_error{"Failed to match keyword 'facet' or 'endsolid'."};
+  buffer.erase(begin(buffer), begin(buffer) + (line_end - buffer.data()));
 
-  while (file >> keyword) {
-    if (keyword == "endsolid") {
-      match(name.c_str());
-      return;
-    } else if (keyword == "facet") {
-      triangle t{};
-      match("normal");
-      file >> t.normal.x >> t.normal.y >> t.normal.z;
-      match("outer");
-      match("loop");
-      for (int i = 0; i < 3; ++i) {
-        match("vertex");
-        file >> t.vertex[i].x >> t.vertex[i].y >> t.vertex[i].z;
+  stl_ascii_chunk chunk{};
+  while (true) {
+    // Only parse up to the end of the last complete facet.
+    // Without such a facet, the buffer needs to grow.
+    //
+    const auto first = buffer.data();
+    const auto last = first + buffer.size();
+    auto limit = last;
+    if (more) {
+      constexpr string_view keyword = "endfacet";
+      const auto i = string_view{first, last}.rfind(keyword);
+      if (i == string_view::npos) {
+        more = read_block();
+        continue;
       }
-      match("endloop");
-      match("endfacet");
-      triangles.push_back(t);
-    } else
-      throw parser_error{"Failed to match keyword 'facet' or 'endsolid'."};
+      limit = first + i + keyword.size();
+    }
+
+    chunk.triangles.clear();
+    parse_stl_ascii_chunk(first, limit, last, chunk);
+    if (chunk.error) rethrow_exception(chunk.error);
+    visit_in_batches(chunk.triangles, visitor, batch_size);
+
+    if (chunk.endsolid) {
+      // Make sure the name is not cut off by the end of the block.
+      const size_t offset = chunk.endsolid - first;
+      if (more && (buffer.size() - offset < name.size() + block_size / 2))
+        more = read_block();
+      if (!name.empty()) {
+        input = {buffer.data() + offset, buffer.data() + buffer.size()};
+        input.match(name);
+      }
+      return;
+    }
+    if (!more) return;
+
+    buffer.erase(begin(buffer), begin(buffer) + (limit - first));
+    more = read_block();
   }
 }
 
+void stl_surface::for_each_batch(const filesystem::path& path,
+                                 const batch_visitor& visitor,
+                                 size_t batch_size) {
+  if (format_of(path) == format::ascii)
+    for_each_ascii_batch(path, visitor, batch_size);
+  else
+    for_each_binary_batch(path, visitor, batch_size);
+}
+
+auto stl_surface::format_of(const filesystem::path& path) -> format {
+  fstream file{path, ios::in | ios::binary};
+  if (!file.is_open())
+    throw runtime_error("Failed to open STL file from path '"s + path.string() +
+                        "'.");
+
+  // Only the start of the file is needed for the detection.
+  //
+  constexpr size_t scan_size = size_t{1} << 12;
+  array<char, scan_size> buffer;
+  file.read(buffer.data(), buffer.size());
+  const string_view str{buffer.data(), size_t(file.gcount())};
+
+  // A binary file is fully determined by its triangle count.
+  //
+  if (str.size() >= stl_binary_view::offset) {
+    size_type count;
+    memcpy(&count, str.data() + stl_binary_view::header_size, sizeof(count));
+    if (file_size(path) == stl_binary_view::offset +
+                               size_t(count) * stl_binary_view::stride)
+      return format::binary;
+  }
+
+  // An ASCII file needs to start with 'solid' and must be followed
+  // by the keyword 'facet' or 'endsolid' in its first lines.
+  //
+  stl_ascii_tokenizer input{str.data(), str.data() + str.size()};
+  if (input.token() != "solid") return format::binary;
+  for (auto token = input.token(); !token.empty(); token = input.token()) {
+    if (token == "endsolid") return format::ascii;
+    if ((token == "facet") && (input.token() == "normal")) return format::ascii;
+  }
+  return format::binary;
+}
+
 stl_surface::stl_surface(const filesystem::path& path, binary_tag) {
   load_from_binary_file(path);
 }
@@ -92,11 +384,10 @@ stl_surface::stl_surface(const filesystem::path& path, ascii_tag) {
 }
 
 stl_surface::stl_surface(const filesystem::path& path) {
-  try {
+  if (format_of(path) == format::ascii)
     load_from_ascii_file(path);
-  } catch (parser_error&) {
+  else
     load_from_binary_file(path);
-  }
 }
 
 }  // namespace hyperreflex
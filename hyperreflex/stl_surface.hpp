@@ -1,5 +1,5 @@
 #pragma once
-#include <hyperreflex/utility.hpp>
+#include <hyperreflex/stl_binary_view.hpp>
 
 namespace hyperreflex {
 
@@ -27,6 +27,23 @@ struct stl_surface {
   static constexpr ascii_tag ascii{};
   static constexpr binary_tag binary{};
 
+  // Cheap detection of the file format that does not parse the file.
+  // Binary files are identified by their size which has to match
+  // the number of triangles given in the header.
+  // Otherwise, only the first few kilobytes are scanned for ASCII keywords.
+  // Note that many binary files start with 'solid' as well.
+  //
+  enum class format { ascii, binary };
+  static auto format_of(const filesystem::path& path) -> format;
+
+  // Find the start of the next 'facet' keyword in '[first, last)'.
+  // ASCII-based files are split into chunks at these positions.
+  // The keyword has to be preceded by whitespace.
+  // So, the character before 'first' has to be readable as well.
+  //
+  static auto next_facet(const char* first, const char* last) noexcept
+      -> const char*;
+
   // The whole structure is meant as a typed cache with structure
   // for an underlying file.
   // So, no constructor extensions are used but only good old
@@ -39,7 +56,31 @@ struct stl_surface {
   void load_from_ascii_file(const filesystem::path& path);
   void load_from_binary_file(const filesystem::path& path);
 
+  // Streaming access for files that may be larger than the main memory.
+  // The file is read in fixed-size blocks and the visitor is called
+  // for consecutive batches of at most 'batch_size' triangles in file order.
+  // Only the memory for one block and one batch will be allocated.
+  //
+  using batch_visitor = function<void(span<const triangle>)>;
+  static constexpr size_t default_batch_size = size_t{1} << 16;
+  static void for_each_batch(const filesystem::path& path,
+                             const batch_visitor& visitor,
+                             size_t batch_size = default_batch_size);
+  static void for_each_ascii_batch(const filesystem::path& path,
+                                   const batch_visitor& visitor,
+                                   size_t batch_size = default_batch_size);
+  static void for_each_binary_batch(const filesystem::path& path,
+                                    const batch_visitor& visitor,
+                                    size_t batch_size = default_batch_size);
+
   vector<triangle> triangles{};
 };
 
+/// Check whether the given path uses the file extension of STL files.
+///
+inline auto is_stl_file(const filesystem::path& path) -> bool {
+  return (path.extension().string() == ".stl") ||
+         (path.extension().string() == ".STL");
+}
+
 }  // namespace hyperreflex
@@ -0,0 +1,86 @@
+#include <hyperreflex/stl_surface.hpp>
+
+using namespace hyperreflex;
+
+namespace {
+
+int failures = 0;
+
+void check(bool success, czstring message) {
+  if (success) return;
+  cerr << "FAILED: " << message << '\n';
+  ++failures;
+}
+
+constexpr string_view two_facets =
+    "  facet normal 0 0 1\n"
+    "    outer loop\n"
+    "      vertex 0 0 0\n"
+    "      vertex 1 0 0\n"
+    "      vertex 0 1 0\n"
+    "    endloop\n"
+    "  endfacet\n"
+    "  facet normal 0 0 1\n";
+
+// A chunk boundary which lands on the 'f' of 'endfacet'
+// has to be moved to the next facet.
+//
+void test_next_facet() {
+  const auto first = two_facets.data();
+  const auto last = first + two_facets.size();
+  const auto facet = first + two_facets.find("facet");
+  const auto endfacet = first + two_facets.find("endfacet");
+  const auto next = first + two_facets.rfind("facet");
+
+  check(stl_surface::next_facet(facet, last) == facet,
+        "facet at the search start is not found");
+  check(stl_surface::next_facet(facet + 1, last) == next,
+        "facet after the search start is not found");
+  check(stl_surface::next_facet(endfacet + 3, last) == next,
+        "chunk boundary on 'endfacet' is not moved to the next facet");
+  check(stl_surface::next_facet(next + 1, last) == last,
+        "missing facet is not reported as end of range");
+}
+
+// Load a file which is large enough to be split into chunks
+// on machines with multiple threads.
+//
+void test_ascii_chunks() {
+  constexpr size_t count = 1 << 16;
+  const auto path = filesystem::temp_directory_path() /
+                    "hyperreflex-stl_surface-test.stl";
+  {
+    ofstream file{path};
+    file << "solid test\n";
+    for (size_t i = 0; i < count; ++i) {
+      file << "  facet normal 0 0 1\n"
+           << "    outer loop\n"
+           << "      vertex " << i << " 0 0\n"
+           << "      vertex 1 0 0\n"
+           << "      vertex 0 1 0\n"
+           << "    endloop\n"
+           << "  endfacet\n";
+    }
+    file << "endsolid test\n";
+  }
+
+  try {
+    const stl_surface surface{path, stl_surface::ascii};
+    check(surface.triangles.size() == count, "wrong number of triangles");
+    bool ordered = true;
+    for (size_t i = 0; i < surface.triangles.size(); ++i)
+      ordered &= (surface.triangles[i].vertex[0].x == float32(i));
+    check(ordered, "triangles are not in file order");
+  } catch (exception& e) {
+    check(false, e.what());
+  }
+  filesystem::remove(path);
+}
+
+}  // namespace
+
+int main() {
+  test_next_facet();
+  test_ascii_chunks();
+  return failures ? 1 : 0;
+}
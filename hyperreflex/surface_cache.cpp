@@ -0,0 +1,211 @@
+#include <hyperreflex/surface_cache.hpp>
+//
+#include <hyperreflex/memory_mapped_file.hpp>
+
+namespace hyperreflex {
+
+namespace {
+
+constexpr array<char, 8> surface_cache_magic{'h', 'y', 'p', 'e',
+                                             'r', 'r', 'f', 'x'};
+
+struct surface_cache_header {
+  array<char, 8> magic;
+  uint32 version;
+  uint32 endianness;
+  uint64 source_size;
+  int64 source_time;
+  uint64 raw_vertex_count;
+  uint64 vertex_count;
+  uint64 face_count;
+  uint64 neighbor_count;
+  aabb3 box;
+};
+
+// The cache file consists of the header followed by
+// the vertices, the faces, the adjacency offsets, the neighbors,
+// the incidence offsets, and the incident faces.
+// Every vertex has three incident faces for every face.
+// Every section starts at a multiple of the cache line size.
+//
+struct surface_cache_layout {
+  static constexpr size_t alignment = 64;
+
+  static constexpr auto aligned(size_t offset) noexcept {
+    return (offset + alignment - 1) / alignment * alignment;
+  }
+
+  constexpr surface_cache_layout(const surface_cache_header& header) noexcept
+      : vertices{aligned(sizeof(surface_cache_header))},
+        faces{aligned(vertices + header.vertex_count *
+                                     sizeof(polyhedral_surface::vertex))},
+        offsets{aligned(faces +
+                        header.face_count * sizeof(polyhedral_surface::face))},
+        neighbors{aligned(offsets + (header.vertex_count + 1) *
+                                        sizeof(vertex_adjacency::size_type))},
+        incidence_offsets{
+            aligned(neighbors + header.neighbor_count *
+                                    sizeof(vertex_adjacency::vertex_id))},
+        incident_faces{
+            aligned(incidence_offsets + (header.vertex_count + 1) *
+                                            sizeof(vertex_faces::size_type))},
+        size{incident_faces +
+             3 * header.face_count * sizeof(vertex_faces::face_id)} {}
+
+  size_t vertices;
+  size_t faces;
+  size_t offsets;
+  size_t neighbors;
+  size_t incidence_offsets;
+  size_t incident_faces;
+  size_t size;
+};
+
+auto source_time_of(const filesystem::path& source) {
+  return int64(last_write_time(source).time_since_epoch().count());
+}
+
+// Check that all faces and neighbors refer to existing vertices,
+// that all incident faces exist, and that the offsets
+// partition the neighbors and the incident faces.
+// The viewer can then not access invalid memory.
+//
+auto valid(const surface_cache& cache) noexcept {
+  const auto n = cache.surface.vertices.size();
+  const auto m = cache.surface.faces.size();
+  const auto& offsets = cache.adjacency.offsets;
+  const auto& neighbors = cache.adjacency.neighbors;
+  const auto& incidence = cache.incidence;
+  const auto in_range = [n](auto vid) { return vid < n; };
+  const auto face_in_range = [m](auto fid) { return fid < m; };
+  if (n > polyhedral_surface::invalid) return false;
+  for (const auto& face : cache.surface.faces)
+    if (!ranges::all_of(face, in_range)) return false;
+  return (offsets.front() == 0) && (offsets.back() == neighbors.size()) &&
+         ranges::is_sorted(offsets) && ranges::all_of(neighbors, in_range) &&
+         (incidence.offsets.front() == 0) &&
+         (incidence.offsets.back() == incidence.faces.size()) &&
+         ranges::is_sorted(incidence.offsets) &&
+         ranges::all_of(incidence.faces, face_in_range);
+}
+
+}  // namespace
+
+auto surface_cache::path_of(const filesystem::path& source)
+    -> filesystem::path {
+  auto result = source;
+  result += ".hyperreflex";
+  return result;
+}
+
+auto surface_cache_from(polyhedral_surface&& surface, size_t raw_vertex_count)
+    -> surface_cache {
+  surface_cache result{.surface = std::move(surface),
+                       .raw_vertex_count = raw_vertex_count};
+  result.box = aabb_from(result.surface);
+  result.adjacency = vertex_adjacency_from(result.surface);
+  result.incidence = vertex_faces_from(result.surface);
+  return result;
+}
+
+auto load_surface_cache(const filesystem::path& source)
+    -> optional<surface_cache> try {
+  const auto path = surface_cache::path_of(source);
+  if (!exists(path)) return {};
+
+  const memory_mapped_file file{path};
+  surface_cache_header header;
+  if (file.size() < sizeof(header)) return {};
+  memcpy(&header, file.data(), sizeof(header));
+
+  // Check whether the cache is valid and still up to date.
+  //
+  if ((header.magic != surface_cache_magic) ||
+      (header.version != surface_cache::version) ||
+      (header.endianness != uint32(endian::native)) ||
+      (header.source_size != file_size(source)) ||
+      (header.source_time != source_time_of(source)))
+    return {};
+  // Huge counts of a broken header would overflow the layout.
+  if ((header.vertex_count > file.size()) ||
+      (header.face_count > file.size()) ||
+      (header.neighbor_count > file.size()))
+    return {};
+  const surface_cache_layout layout{header};
+  if (file.size() != layout.size) return {};
+
+  surface_cache result{};
+  auto& surface = result.surface;
+  auto& adjacency = result.adjacency;
+  auto& incidence = result.incidence;
+  surface.vertices.resize(header.vertex_count);
+  surface.faces.resize(header.face_count);
+  adjacency.offsets.resize(header.vertex_count + 1);
+  adjacency.neighbors.resize(header.neighbor_count);
+  incidence.offsets.resize(header.vertex_count + 1);
+  incidence.faces.resize(3 * header.face_count);
+  const auto read = [&](size_t offset, auto& data) {
+    memcpy(data.data(), file.data() + offset, data.size() * sizeof(data[0]));
+  };
+  read(layout.vertices, surface.vertices);
+  read(layout.faces, surface.faces);
+  read(layout.offsets, adjacency.offsets);
+  read(layout.neighbors, adjacency.neighbors);
+  read(layout.incidence_offsets, incidence.offsets);
+  read(layout.incident_faces, incidence.faces);
+  result.raw_vertex_count = header.raw_vertex_count;
+  result.box = header.box;
+  if (!valid(result)) return {};
+  return result;
+} catch (const exception&) {
+  // A cache that cannot be read is treated like a missing one.
+  return {};
+}
+
+void save_surface_cache(const filesystem::path& source,
+                        const surface_cache& cache) {
+  const auto path = surface_cache::path_of(source);
+  auto tmp = path;
+  tmp += ".tmp";
+
+  const surface_cache_header header{
+      .magic = surface_cache_magic,
+      .version = surface_cache::version,
+      .endianness = uint32(endian::native),
+      .source_size = file_size(source),
+      .source_time = source_time_of(source),
+      .raw_vertex_count = cache.raw_vertex_count,
+      .vertex_count = cache.surface.vertices.size(),
+      .face_count = cache.surface.faces.size(),
+      .neighbor_count = cache.adjacency.neighbors.size(),
+      .box = cache.box,
+  };
+  const surface_cache_layout layout{header};
+
+  {
+    fstream file{tmp, ios::out | ios::binary | ios::trunc};
+    if (!file.is_open())
+      throw runtime_error("Failed to open surface cache file '"s +
+                          tmp.string() + "' for writing.");
+    const auto write = [&](size_t offset, const auto& data) {
+      // Fill the gap to the aligned start of the section with zeros.
+      const auto position = size_t(file.tellp());
+      for (auto i = position; i < offset; ++i) file.put('\0');
+      file.write(reinterpret_cast<const char*>(data.data()),
+                 data.size() * sizeof(data[0]));
+    };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write(layout.vertices, cache.surface.vertices);
+    write(layout.faces, cache.surface.faces);
+    write(layout.offsets, cache.adjacency.offsets);
+    write(layout.neighbors, cache.adjacency.neighbors);
+    write(layout.incidence_offsets, cache.incidence.offsets);
+    write(layout.incident_faces, cache.incidence.faces);
+    if (!file)
+      throw runtime_error("Failed to write surface cache file '"s +
+                          tmp.string() + "'.");
+  }
+  rename(tmp, path);
+}
+
+}  // namespace hyperreflex
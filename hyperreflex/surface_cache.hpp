@@ -0,0 +1,49 @@
+#pragma once
+#include <hyperreflex/adjacency.hpp>
+
+namespace hyperreflex {
+
+// A processed surface together with its derived data.
+// Parsing and welding large meshes takes seconds.
+// So, this data is stored in a binary cache file next to the source file.
+// The cache is invalidated when the size or the last write time
+// of the source file changes, similar to the reload of shaders.
+//
+struct surface_cache {
+  static constexpr uint32 version = 3;
+
+  // The cache file for 'model.stl' is 'model.stl.hyperreflex'.
+  //
+  static auto path_of(const filesystem::path& source) -> filesystem::path;
+
+  polyhedral_surface surface{};
+  // Number of vertices in the source file before welding
+  size_t raw_vertex_count{};
+  aabb3 box{};
+  vertex_adjacency adjacency{};
+  vertex_faces incidence{};
+};
+
+/// Compute all derived data of a surface to be stored in a cache.
+///
+auto surface_cache_from(polyhedral_surface&& surface, size_t raw_vertex_count)
+    -> surface_cache;
+
+/// Load the cache of a source file by memory-mapping.
+/// Every section of the mapping is copied into its owning array
+/// by a single 'memcpy' such that the cache stays independent of the file.
+/// So, loading is bound by the memory bandwidth and needs no parsing.
+/// If there is no cache or if it is outdated, broken, or inconsistent,
+/// nothing is returned and the source file needs to be loaded.
+///
+auto load_surface_cache(const filesystem::path& source)
+    -> optional<surface_cache>;
+
+/// Write the cache for a source file.
+/// The file is written to a temporary path first and then renamed.
+/// So, concurrent readers will never see a partially written cache.
+///
+void save_surface_cache(const filesystem::path& source,
+                        const surface_cache& cache);
+
+}  // namespace hyperreflex
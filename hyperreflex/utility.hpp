@@ -4,12 +4,15 @@
 #include <atomic>
 #include <bit>
 #include <cassert>
+#include <charconv>
 #include <chrono>
 #include <cmath>
 #include <concepts>
 #include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <future>
 #include <iomanip>
 #include <iostream>
@@ -17,7 +20,10 @@
 #include <mutex>
 #include <numbers>
 #include <numeric>
+#include <optional>
+#include <queue>
 #include <ranges>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
@@ -56,6 +62,9 @@ using uint8 = uint8_t;
 using uint16 = uint16_t;
 using uint32 = uint32_t;
 using uint64 = uint64_t;
+using int8 = int8_t;
+using int32 = int32_t;
+using int64 = int64_t;
 using float32 = float;
 using float64 = double;
 using real = float32;
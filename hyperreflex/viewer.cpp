@@ -1,11 +1,13 @@
 #include <hyperreflex/viewer.hpp>
 //
 #include <hyperreflex/math.hpp>
+#include <hyperreflex/ply_surface.hpp>
+#include <hyperreflex/stl_surface.hpp>
+#include <hyperreflex/surface_cache.hpp>
+#include <hyperreflex/welding.hpp>
 //
 #include <geometrycentral/surface/flip_geodesics.h>
 #include <geometrycentral/surface/halfedge_element_types.h>
-//
-#include <igl/avg_edge_length.h>
 
 namespace hyperreflex {
 
@@ -139,6 +141,24 @@ void viewer::process_events() {
         case sf::Keyboard::S:
           smooth_line_drawing = !smooth_line_drawing;
           break;
+        case sf::Keyboard::E: {
+          auto path = surface_path;
+          path += ".export.ply";
+          export_surface(path);
+        } break;
+        case sf::Keyboard::P: {
+          auto path = surface_path;
+          path += ".render.png";
+          render_image(path);
+        } break;
+        case sf::Keyboard::I:
+          print_ray_statistics();
+          break;
+        case sf::Keyboard::L:
+          local_heat = !local_heat;
+          update_heat();
+          smooth_line();
+          break;
       }
     }
   }
@@ -188,6 +208,7 @@ void viewer::update_view() {
 
 void viewer::update() {
   handle_surface_load_task();
+  handle_heat_task();
   if (view_should_update) {
     update_view();
     view_should_update = false;
@@ -258,8 +279,9 @@ void viewer::zoom(float scale) {
 }
 
 void viewer::look_at(float x, float y) {
+  if (!surface_ready) return;
   const auto r = cam.primary_ray(x, y);
-  if (const auto p = intersection(r, surface)) {
+  if (const auto p = surface_intersection(r)) {
     origin = r(p.t);
     radius = p.t;
     view_should_update = true;
@@ -282,42 +304,171 @@ void viewer::set_y_as_up() {
 
 void viewer::load_surface(const filesystem::path& path) {
   const auto loader = [this](const filesystem::path& path) {
+    const auto advance = [this](load_stage stage) {
+      surface_load_stage.store(stage, memory_order_release);
+    };
     try {
+      // Reopening a known file only needs to read its cache.
+      //
       const auto load_start = clock::now();
-      surface.host() = polyhedral_surface_from(path);
-      const auto load_end = clock::now();
+      auto cache = load_surface_cache(path);
+      surface_from_cache = cache.has_value();
+      if (surface_from_cache) {
+        const auto load_end = clock::now();
+        surface_load_time = duration<float32>(load_end - load_start).count();
+        surface_process_time = 0;
+        surface_raw_vertex_count = cache->raw_vertex_count;
+      } else if (is_stl_file(path) &&
+                 (file_size(path) >= stl_streaming_threshold)) {
+        // Huge STL files are streamed and welded on the fly.
+        // So, the unwelded triangles never need to be stored.
+        //
+        auto data = welded_stl_surface_from(path);
+        surface_raw_vertex_count = data.corner_count;
+        cache = surface_cache_from(std::move(data.surface),
+                                   surface_raw_vertex_count);
+        const auto load_end = clock::now();
+
+        surface_load_time = duration<float32>(load_end - load_start).count();
+        surface_process_time = 0;
+      } else {
+        auto data = polyhedral_surface_from(path);
+        const auto load_end = clock::now();
+
+        // Formats like STL store three separate vertices for every face.
+        // Shared vertices need to be merged to get a connected surface.
+        //
+        advance(weld_stage);
+        const auto process_start = clock::now();
+        surface_raw_vertex_count = data.vertices.size();
+        cache = surface_cache_from(welded(data), surface_raw_vertex_count);
+        const auto process_end = clock::now();
+
+        // Evaluate loading and processing time.
+        surface_load_time = duration<float32>(load_end - load_start).count();
+        surface_process_time =
+            duration<float32>(process_end - process_start).count();
+      }
+      advance(index_stage);
+      if (!surface_from_cache) {
+        // A missing cache only slows down the next start.
+        //
+        try {
+          save_surface_cache(path, *cache);
+        } catch (exception& e) {
+          cout << "WARNING: " << e.what() << endl;
+        }
+      }
 
+      surface.host() = std::move(cache->surface);
+      surface_box = cache->box;
+      surface_adjacency = std::move(cache->adjacency);
+      surface_incidence = std::move(cache->incidence);
+
+      // Ray queries for picking run against the BVH
+      // and picked points snap to the nearest vertex.
+      // Huge surfaces use the compressed BVH to save memory.
+      //
+      const auto bvh_start = clock::now();
+      surface_bvh = {};
+      surface_compressed_bvh = {};
+      surface_index_vertices = {};
+      surface_bvh_compressed = prefers_compressed_bvh(surface);
+      if (surface_bvh_compressed)
+        surface_compressed_bvh = compressed_bvh_from(surface);
+      else
+        surface_bvh = bvh_from(surface);
+      surface_vertex_tree = kd_tree_from(surface.vertices);
+      const auto bvh_end = clock::now();
+      surface_bvh_time = duration<float32>(bvh_end - bvh_start).count();
       cout << "loaded" << endl;
-      // Evaluate loading and processing time.
-      surface_load_time = duration<float32>(load_end - load_start).count();
 
     } catch (exception& e) {
       cout << "failed.\n" << e.what() << endl;
+      surface_load_failed = true;
       return;
     }
+
+    // The viewer draws the surface from now on
+    // while the data for geodesics is computed.
+    //
+    try {
+      advance(topology_stage);
+      const auto topology_start = clock::now();
+      compute_topology_and_geometry();
+      const auto topology_end = clock::now();
+      topology_time =
+          duration<float32>(topology_end - topology_start).count();
+
+      advance(heat_stage);
+      compute_heat_data();
+      advance(loaded_stage);
+    } catch (exception& e) {
+      cout << "ERROR: Precomputation of geodesic data failed.\n"
+           << e.what() << endl;
+      surface_load_failed = true;
+    }
   };
+  // A running heat update reads the data of the current surface.
+  if (heat_task.valid()) heat_task.wait();
+  heat_task = {};
+  heat_should_update = false;
+  ++line_generation;
+
+  surface_path = path;
+  surface_ready = false;
+  geodesics_ready = false;
+  surface_load_failed = false;
+  surface_load_stage = parse_stage;
   surface_load_task = async(launch::async, loader, path);
   cout << "Loading " << path << "..." << endl;
 }
 
 void viewer::handle_surface_load_task() {
   if (!surface_load_task.valid()) return;
-  if (future_status::ready != surface_load_task.wait_for(0s)) {
-    // cout << "." << flush;
-    return;
+
+  const auto stage = surface_load_stage.load(memory_order_acquire);
+  if (stage != surface_shown_stage) {
+    surface_shown_stage = stage;
+    update_window_title();
   }
-  cout << "done." << endl << '\n';
+
+  // Show the surface as soon as its buffers can be uploaded.
+  //
+  if (!surface_ready && (stage > index_stage)) {
+    surface.update();
+    fit_view();
+    print_surface_info();
+    surface_ready = true;
+  }
+
+  if (future_status::ready != surface_load_task.wait_for(0s)) return;
+  surface_load_task.get();
   surface_load_task = {};
+  update_window_title();
+  if (surface_load_failed) return;
 
-  surface.update();
-  fit_view();
-  print_surface_info();
-  compute_topology_and_geometry();
-  compute_heat_data();
+  potential.assign(surface.vertices.size(), 0);
+  device_heat.allocate_and_initialize(potential);
+  print_geodesics_info();
+  geodesics_ready = true;
+  cout << "done." << endl << '\n';
+}
+
+void viewer::update_window_title() {
+  auto title = "hyperreflex - "s + surface_path.filename().string();
+  if (surface_load_task.valid() && (surface_shown_stage < loaded_stage)) {
+    title += " - "s + load_stage_names[surface_shown_stage] + "... (" +
+             to_string(surface_shown_stage + 1) + "/" +
+             to_string(load_stage_names.size()) + ")";
+  } else if (surface_load_failed) {
+    title += " - "s + load_stage_names[surface_shown_stage] + " failed";
+  }
+  window.setTitle(title);
 }
 
 void viewer::fit_view() {
-  const auto box = aabb_from(surface);
+  const auto& box = surface_box;
   origin = box.origin();
   bounding_radius = box.radius();
   radius = bounding_radius / tan(0.5f * cam.vfov());
@@ -331,23 +482,72 @@ void viewer::print_surface_info() {
   cout << setprecision(3) << fixed << boolalpha;
   cout << setw(left_width) << "load time"
        << " = " << setw(right_width) << surface_load_time << " s\n"
-       << setw(left_width) << "process time"
+       << setw(left_width) << "weld time"
        << " = " << setw(right_width) << surface_process_time << " s\n"
+       << setw(left_width) << "index time"
+       << " = " << setw(right_width) << surface_bvh_time << " s\n"
+       << setw(left_width) << "cached"
+       << " = " << setw(right_width) << surface_from_cache << '\n'
        << '\n';
 
-  cout << setw(left_width) << "vertices"
+  cout << setw(left_width) << "loaded vertices"
+       << " = " << setw(right_width) << surface_raw_vertex_count << '\n'
+       << setw(left_width) << "vertices"
        << " = " << setw(right_width) << surface.vertices.size() << '\n'
+       << setw(left_width) << "dedup ratio"
+       << " = " << setw(right_width)
+       << float32(surface_raw_vertex_count) /
+              std::max(size_t{1}, surface.vertices.size())
+       << '\n'
        << setw(left_width) << "faces"
        << " = " << setw(right_width) << surface.faces.size() << '\n'
+       << setw(left_width) << "bvh nodes"
+       << " = " << setw(right_width)
+       << (surface_bvh_compressed ? surface_compressed_bvh.nodes.size()
+                                  : surface_bvh.nodes.size())
+       << '\n'
+       << setw(left_width) << "compressed bvh"
+       << " = " << setw(right_width) << surface_bvh_compressed << '\n'
        << endl;
 }
 
+void viewer::print_geodesics_info() {
+  constexpr auto left_width = 20;
+  constexpr auto right_width = 10;
+  cout << setprecision(3) << fixed << boolalpha;
+  cout << setw(left_width) << "topology time"
+       << " = " << setw(right_width) << topology_time << " s\n"
+       << setw(left_width) << "heat time"
+       << " = " << setw(right_width) << heat_time << " s\n"
+       << setw(left_width) << "heat cached"
+       << " = " << setw(right_width) << heat_from_cache << '\n'
+       << endl;
+}
+
+void viewer::print_ray_statistics() {
+  if constexpr (!ray_statistics_enabled) {
+    cout << "Ray statistics are disabled. "
+            "Build with 'config.hyperreflex.ray_statistics=true'.\n"
+         << endl;
+    return;
+  }
+  constexpr auto left_width = 20;
+  cout << setprecision(3) << fixed;
+  cout << setw(left_width) << "last selection"
+       << " = " << selection_ray_statistics << '\n'
+       << setw(left_width) << "all rays"
+       << " = " << total_ray_statistics() << '\n'
+       << endl;
+  reset_ray_statistics();
+}
+
 void viewer::load_shader(const filesystem::path& path, const string& name) {
   shaders.load_shader(path);
   shaders.add_name(path, name);
 }
 
 void viewer::sort_surface_faces_by_depth() {
+  if (!surface_ready) return;
   auto faces = surface.faces;
   sort(begin(faces), end(faces), [&](const auto& f1, const auto& f2) {
     const auto& v = surface.vertices;
@@ -362,25 +562,33 @@ void viewer::sort_surface_faces_by_depth() {
   surface.device_faces.allocate_and_initialize(faces);
 }
 
+auto viewer::surface_intersection(const ray& r) const
+    -> ray_polyhedral_surface_intersection {
+  if (!surface_bvh_compressed) return intersection(r, surface_bvh);
+  const auto& vertices = displacing ? surface_index_vertices : surface.vertices;
+  return intersection(r, surface_compressed_bvh, span{vertices},
+                      span{surface.faces});
+}
+
 auto viewer::select_vertex(float x, float y) -> polyhedral_surface::vertex_id {
   const auto r = cam.primary_ray(x, y);
-  const auto p = intersection(r, surface);
+  const auto statistics = thread_ray_statistics();
+  const auto p = surface_intersection(r);
+  selection_ray_statistics = thread_ray_statistics() - statistics;
   if (!p) return polyhedral_surface::invalid;
 
-  const auto& f = surface.faces[p.f];
-  const auto w = real(1) - p.u - p.v;
-
-  // const auto position = surface.vertices[f[0]].position * w +
-  //                       surface.vertices[f[1]].position * u +
-  //                       surface.vertices[f[2]].position * v;
-  return f[0];
+  return nearest(r(p.t), surface_vertex_tree).id;
 }
 
 void viewer::select_origin_vertex(float x, float y) {
+  // Lines are computed on the topology of the surface.
+  if (!geodesics_ready) return;
   device_line.vertices.clear();
   device_line.update();
   destination_vertex = polyhedral_surface::invalid;
   line_vids.clear();
+  line_heat = {};
+  ++line_generation;
   origin_vertex = select_vertex(x, y);
   if (origin_vertex == polyhedral_surface::invalid) return;
   // cout << "origin vid = " << origin_vertex << endl;
@@ -388,13 +596,14 @@ void viewer::select_origin_vertex(float x, float y) {
 }
 
 void viewer::select_destination_vertex(float x, float y) {
+  if (!geodesics_ready) return;
   const auto vid = select_vertex(x, y);
   if (vid == polyhedral_surface::invalid) return;
   destination_vertex = vid;
   // cout << "destination vid = " << destination_vertex << endl;
   // compute_dijkstra_path();
   update_line();
-  update_heat();
+  request_heat_update();
 }
 
 void viewer::compute_topology_and_geometry() {
@@ -525,54 +734,109 @@ void viewer::shorten_line() {
 }
 
 void viewer::compute_heat_data() {
-  // Construct vertex matrix.
-  //
-  surface_vertex_matrix.resize(surface.vertices.size(), 3);
-  for (size_t i = 0; i < surface.vertices.size(); ++i)
-    for (size_t j = 0; j < 3; ++j)
-      surface_vertex_matrix(i, j) = surface.vertices[i].position[j];
+  const auto start = clock::now();
+  const auto time_step = heat_time_step(surface);
+  const auto key = heat_cache::key_of(surface, time_step);
+  const auto topology_key = heat_cache::topology_key_of(surface);
+  auto cache = load_heat_cache(surface_path, key);
+  heat_from_cache = cache.has_value();
+  if (heat_from_cache) {
+    heat_data = std::move(*cache);
+  } else {
+    // If only the vertex positions have changed,
+    // the symbolic analysis of the cache can still be used.
+    //
+    auto analysis = load_heat_analysis(surface_path, topology_key);
+    heat_data = analysis ? heat_method_from<float32>(surface, time_step,
+                                                     std::move(*analysis))
+                         : heat_method_from<float32>(surface, time_step);
+    // A missing cache only slows down the next start.
+    //
+    try {
+      save_heat_cache(surface_path, key, topology_key, heat_data);
+    } catch (exception& e) {
+      cout << "WARNING: " << e.what() << endl;
+    }
+  }
+  const auto end = clock::now();
+  heat_time = duration<float32>(end - start).count();
+}
+
+void viewer::request_heat_update() {
+  if (!geodesics_ready) return;
+  heat_should_update = true;
+}
+
+void viewer::handle_heat_task() {
+  if (heat_task.valid()) {
+    if (future_status::ready != heat_task.wait_for(0s)) return;
+    auto result = heat_task.get();
+    heat_task = {};
+    // Results of a line that has been replaced in the meantime are dropped.
+    if (result.line_generation == line_generation) {
+      line_heat = std::move(result.line_heat);
+      heat = std::move(result.heat);
+      potential = std::move(result.potential);
+      device_heat.allocate_and_initialize(potential);
+      lifted_geometry = {};
+    }
+  }
+  if (!heat_should_update) return;
+  heat_should_update = false;
 
-  // Construct face matrix.
+  // The task only reads data that is fixed after loading the surface.
+  // The line and the parameters are copied at the time of the launch
+  // and the heat of the line is handed over until the task has finished.
   //
-  surface_face_matrix.resize(surface.faces.size(), 3);
-  for (size_t i = 0; i < surface.faces.size(); ++i)
-    for (size_t j = 0; j < 3; ++j)
-      surface_face_matrix(i, j) = surface.faces[i][j];
+  const auto solve = [this](size_t generation,
+                            vector<polyhedral_surface::vertex_id> vids,
+                            heat_field field, bool local, float32 tolerance) {
+    heat_update result{.line_generation = generation,
+                       .line_heat = std::move(field)};
+    auto& heat = result.heat;
+    if (local) {
+      const auto radius = local_heat_radius * bounding_radius;
+      heat = local_geodesic_distances(heat_data, surface, surface_adjacency,
+                                      surface_incidence, vids, radius);
+      for (auto& x : heat) x = std::min(x, radius);
+    } else {
+      // Only vertices that have been added to the line since the last update
+      // need to be diffused. The heat of all others is reused.
+      add_heat_sources(heat_data, result.line_heat, vids);
+      heat = geodesic_distances(heat_data, surface, result.line_heat);
+    }
 
-  // Construct heat data.
-  //
-  auto t =
-      pow(igl::avg_edge_length(surface_vertex_matrix, surface_face_matrix), 2);
-  if (!igl::heat_geodesics_precompute(surface_vertex_matrix,
-                                      surface_face_matrix, t, heat_data)) {
-    cerr << "ERROR: Precomputation of heat data failed." << endl;
-    exit(1);
-  }
+    auto& potential = result.potential;
+    potential.assign(heat.size(), 0);
+    float32 max_heat = 0;
+    for (size_t i = 0; i < heat.size(); ++i)
+      max_heat = std::max(max_heat, heat[i]);
+    for (size_t i = 0; i < potential.size(); ++i)
+      potential[i] = heat[i] / max_heat;
+    const auto modifier = [tolerance](auto x) {
+      return (x <= 1e-4f) ? 0 : exp(-1.0f / tolerance / x);
+    };
+    for (size_t i = 0; i < potential.size(); ++i)
+      potential[i] = modifier(potential[i]);
+    return result;
+  };
+  heat_task = async(launch::async, solve, line_generation, line_vids,
+                    std::move(line_heat), local_heat, tolerance);
+}
 
-  potential.assign(surface.vertices.size(), 0);
-  device_heat.allocate_and_initialize(potential);
+void viewer::finish_heat_update() {
+  while (heat_task.valid() || heat_should_update) {
+    if (heat_task.valid()) heat_task.wait();
+    handle_heat_task();
+  }
 }
 
 void viewer::update_heat() {
-  heat = Eigen::VectorXd::Zero(surface_vertex_matrix.rows());
-  Eigen::VectorXi gamma(line_vids.size());
-  for (size_t i = 0; i < line_vids.size(); ++i) gamma[i] = line_vids[i];
-
-  igl::heat_geodesics_solve(heat_data, gamma, heat);
-
-  potential.assign(heat.size(), 0);
-  double max_heat = 0;
-  for (size_t i = 0; i < heat.size(); ++i)
-    max_heat = std::max(max_heat, heat[i]);
-  for (size_t i = 0; i < potential.size(); ++i)
-    potential[i] = heat[i] / max_heat;
-  const auto modifier = [this](auto x) {
-    return (x <= 1e-4f) ? 0 : exp(-1.0f / tolerance / x);
-  };
-  for (size_t i = 0; i < potential.size(); ++i)
-    potential[i] = modifier(potential[i]);
-  device_heat.allocate_and_initialize(potential);
+  request_heat_update();
+  finish_heat_update();
+}
 
+void viewer::update_lifted_geometry() {
   // Generate vertex data for constructors.
   //
   using namespace geometrycentral;
@@ -590,12 +854,19 @@ void viewer::update_heat() {
   lifted_geometry = make_unique<EdgeLengthGeometry>(*mesh, edge_lengths);
 }
 
-void viewer::add_normal_displacement() {
+auto viewer::displaced_vertices() const
+    -> vector<polyhedral_surface::vertex> {
   auto vertices = surface.vertices;
   for (size_t i = 0; auto& v : vertices) {
     v.position += 0.5f * bounding_radius * potential[i] * v.normal;
     ++i;
   }
+  return vertices;
+}
+
+void viewer::add_normal_displacement() {
+  if (!geodesics_ready) return;
+  const auto vertices = displaced_vertices();
   surface.device_vertices.allocate_and_initialize(vertices);
 
   // Generate vertex data for constructors.
@@ -612,16 +883,93 @@ void viewer::add_normal_displacement() {
   displaced_geometry =
       make_unique<VertexPositionGeometry>(*mesh, geometry_vertices);
 
+  // Picking has to hit the surface that is drawn.
   displacing = true;
+  update_surface_indices(vertices);
 }
 
 void viewer::remove_normal_displacement() {
+  if (!surface_ready) return;
   surface.device_vertices.allocate_and_initialize(surface.vertices);
+  if (!displacing) return;
   displacing = false;
+  update_surface_indices(surface.vertices);
+}
+
+void viewer::update_surface_indices(
+    const vector<polyhedral_surface::vertex>& vertices) {
+  const auto start = clock::now();
+  size_t rebuilds = 0;
+  if (surface_bvh_compressed) {
+    // The compressed BVH cannot be refitted and is rebuilt instead.
+    // It refers to the vertices of its queries.
+    // So, displaced vertices need to be kept.
+    //
+    polyhedral_surface indexed{.vertices = vertices, .faces = surface.faces};
+    surface_compressed_bvh = compressed_bvh_from(indexed);
+    surface_index_vertices = displacing ? std::move(indexed.vertices)
+                                        : vector<polyhedral_surface::vertex>{};
+  } else {
+    rebuilds = refit(surface_bvh, vertices, surface.faces,
+                     surface_bvh_rebuild_factor);
+  }
+  surface_vertex_tree = kd_tree_from(vertices);
+  const auto end = clock::now();
+  cout << "Updated spatial indices in "
+       << duration<float32>(end - start).count() << " s";
+  if (rebuilds > 0) cout << " with " << rebuilds << " rebuilt BVH subtrees";
+  cout << '.' << endl;
+}
+
+void viewer::export_surface(const filesystem::path& path) {
+  if (!surface_ready) return;
+  // The displacement is only applied on the GPU.
+  // So, its vertex positions need to be computed again.
+  //
+  polyhedral_surface data{};
+  data.vertices = displacing ? displaced_vertices() : surface.vertices;
+  data.faces = surface.faces;
+  try {
+    save_ply_file(data, path);
+    cout << "Exported surface to " << path << "." << endl;
+  } catch (exception& e) {
+    cout << "WARNING: " << e.what() << endl;
+  }
+}
+
+void viewer::render_image(const filesystem::path& path) {
+  if (!surface_ready) return;
+  // The software renderer draws the current view
+  // like the surface and line shaders.
+  //
+  const auto vertices = displacing ? displaced_vertices() : surface.vertices;
+  vector<render_curve> curves{{.points = device_initial_line.vertices,
+                               .color = {0.0f, 0.0f, 0.0f, 0.3f}}};
+  if (smooth_line_drawing) curves.push_back({.points = device_line.vertices});
+  try {
+    const auto start = clock::now();
+    const render_settings settings{
+        .heat = potential, .curves = curves, .lighting = lighting};
+    const auto image =
+        surface_bvh_compressed
+            ? hyperreflex::render(cam, surface_compressed_bvh, vertices,
+                                  surface.faces, settings)
+            : hyperreflex::render(cam, surface_bvh, vertices, surface.faces,
+                                  settings);
+    const auto end = clock::now();
+    save_image_file(image, path);
+    cout << "Rendered " << path << " in "
+         << duration<float32>(end - start).count() << " s." << endl;
+  } catch (exception& e) {
+    cout << "WARNING: " << e.what() << endl;
+  }
 }
 
 void viewer::smooth_line() {
   if (line_vids.size() <= 1) return;
+  // The line is smoothed on the heat of its latest vertices.
+  finish_heat_update();
+  if (!lifted_geometry) update_lifted_geometry();
 
   using namespace geometrycentral;
   using namespace surface;
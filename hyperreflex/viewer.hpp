@@ -1,16 +1,21 @@
 #pragma once
+#include <hyperreflex/adjacency.hpp>
+#include <hyperreflex/bvh.hpp>
+#include <hyperreflex/compressed_bvh.hpp>
 #include <hyperreflex/camera.hpp>
+#include <hyperreflex/heat_cache.hpp>
+#include <hyperreflex/kd_tree.hpp>
+#include <hyperreflex/local_heat_method.hpp>
 #include <hyperreflex/opengl/opengl.hpp>
 #include <hyperreflex/points.hpp>
 #include <hyperreflex/polyhedral_surface.hpp>
+#include <hyperreflex/renderer.hpp>
 #include <hyperreflex/shader_manager.hpp>
 #include <hyperreflex/utility.hpp>
 //
 #include <geometrycentral/surface/edge_length_geometry.h>
 #include <geometrycentral/surface/manifold_surface_mesh.h>
 #include <geometrycentral/surface/vertex_position_geometry.h>
-//
-#include <igl/heat_geodesics.h>
 
 namespace hyperreflex {
 
@@ -52,13 +57,18 @@ class viewer : viewer_context {
 
   void load_surface(const filesystem::path& path);
   void handle_surface_load_task();
+  void update_window_title();
   void fit_view();
   void print_surface_info();
+  void print_geodesics_info();
+  void print_ray_statistics();
 
   void load_shader(const filesystem::path& path, const string& name);
 
   void sort_surface_faces_by_depth();
 
+  auto surface_intersection(const ray& r) const
+      -> ray_polyhedral_surface_intersection;
   auto select_vertex(float x, float y) -> polyhedral_surface::vertex_id;
   void select_origin_vertex(float x, float y);
   void select_destination_vertex(float x, float y);
@@ -70,10 +80,20 @@ class viewer : viewer_context {
   void shorten_line();
 
   void compute_heat_data();
+  void request_heat_update();
+  void handle_heat_task();
+  void finish_heat_update();
   void update_heat();
+  void update_lifted_geometry();
 
+  auto displaced_vertices() const -> vector<polyhedral_surface::vertex>;
   void add_normal_displacement();
   void remove_normal_displacement();
+  void update_surface_indices(
+      const vector<polyhedral_surface::vertex>& vertices);
+
+  void export_surface(const filesystem::path& path);
+  void render_image(const filesystem::path& path);
 
   void smooth_line();
 
@@ -103,9 +123,55 @@ class viewer : viewer_context {
   // if the data would be loaded by a blocking call.
   // Here, an asynchronous task is used
   // to get rid of this unresponsiveness.
+  // It runs all stages from parsing the file to factorizing the heat method.
+  // The surface is drawn as soon as it has been indexed
+  // and geodesics are available after the last stage.
+  enum load_stage : uint32 {
+    parse_stage,
+    weld_stage,
+    index_stage,
+    topology_stage,
+    heat_stage,
+    loaded_stage,
+  };
+  static constexpr array<czstring, loaded_stage> load_stage_names{
+      "parsing", "welding", "indexing", "building topology",
+      "factorizing heat method"};
   future<void> surface_load_task{};
+  // The task only advances the stage after it has written all data
+  // of the finished stages. Afterwards, this data is never written again
+  // by the task and may be read by the viewer.
+  // A failed stage stops the task without advancing.
+  atomic<load_stage> surface_load_stage = loaded_stage;
+  atomic<bool> surface_load_failed = false;
+  load_stage surface_shown_stage = loaded_stage;
+  // Picking and drawing need the indexed surface.
+  // Lines and heat need its topology and the heat method.
+  bool surface_ready = false;
+  bool geodesics_ready = false;
+  filesystem::path surface_path{};
   float32 surface_load_time{};
   float32 surface_process_time{};
+  size_t surface_raw_vertex_count{};
+  bool surface_from_cache = false;
+  //
+  aabb3 surface_box{};
+  vertex_adjacency surface_adjacency{};
+  vertex_faces surface_incidence{};
+  bvh surface_bvh{};
+  // Huge surfaces are picked and rendered by the compressed BVH instead.
+  // Its queries need the vertices it has been built for
+  // which differ from the surface's ones for displacements.
+  bool surface_bvh_compressed = false;
+  compressed_bvh surface_compressed_bvh{};
+  vector<polyhedral_surface::vertex> surface_index_vertices{};
+  float32 surface_bvh_time{};
+  kd_tree surface_vertex_tree{};
+  // Work of the ray query of the last vertex selection
+  ray_statistics selection_ray_statistics{};
+  // Subtrees of the BVH are rebuilt after displacements
+  // when their SAH cost has grown by more than this factor.
+  static constexpr float32 surface_bvh_rebuild_factor = 1.5f;
   //
   float bounding_radius;
 
@@ -113,6 +179,7 @@ class viewer : viewer_context {
 
   unique_ptr<geometrycentral::surface::ManifoldSurfaceMesh> mesh{};
   unique_ptr<geometrycentral::surface::VertexPositionGeometry> geometry{};
+  float32 topology_time{};
 
   // Drawing lines.
   //
@@ -126,19 +193,43 @@ class viewer : viewer_context {
   points device_initial_line;
   vector<polyhedral_surface::vertex_id> line_vids{};
 
-  // Heat Geodsics from libigl
+  // Heat Geodesics
+  // The factorizations are loaded from their cache if possible.
   //
-  Eigen::MatrixXd surface_vertex_matrix;
-  Eigen::MatrixXi surface_face_matrix;
-  igl::HeatGeodesicsData<double> heat_data;
-  Eigen::VectorXd heat;
+  heat_method heat_data{};
+  float32 heat_time{};
+  bool heat_from_cache = false;
+  // Heat of the current line's vertices which only grows with the line
+  heat_field line_heat{};
+  // In local mode, distances are only solved in a band around the line
+  // whose radius is relative to the bounding radius.
+  // Farther distances saturate at the band's radius.
+  bool local_heat = false;
+  float32 local_heat_radius = 0.2f;
+  vector<float32> heat{};
   opengl::vertex_buffer device_heat{};
   vector<float> potential;
+  // Solving the heat takes longer than a frame on large surfaces.
+  // So, moving the line's destination only requests an update
+  // that is solved by an asynchronous task for the latest line.
+  // Requests that arrive in the meantime are merged into one.
+  // Its results are applied by the viewer when the task has finished.
+  struct heat_update {
+    size_t line_generation{};
+    heat_field line_heat{};
+    vector<float32> heat{};
+    vector<float> potential{};
+  };
+  future<heat_update> heat_task{};
+  bool heat_should_update = false;
+  // Counts the started lines to detect results of replaced ones.
+  size_t line_generation = 0;
   //
   bool displacing = false;
   unique_ptr<geometrycentral::surface::VertexPositionGeometry>
       displaced_geometry{};
 
+  // Smoothing builds it on demand for the current potential.
   unique_ptr<geometrycentral::surface::EdgeLengthGeometry> lifted_geometry{};
 
   float tolerance = 10.0f;
@@ -0,0 +1,368 @@
+#include <hyperreflex/welding.hpp>
+//
+#include <hyperreflex/parallel.hpp>
+
+namespace hyperreflex {
+
+namespace {
+
+constexpr auto mix(uint64 x) noexcept -> uint64 {
+  // SplitMix64 Finalizer
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  return x;
+}
+
+// Spatial hash of vertex positions.
+// For 'epsilon = 0', the exact bit pattern of a position is its key.
+// Otherwise, positions are mapped to cubic cells with edge length
+// '2 * epsilon' and the nearest neighbor cells have to be checked as well.
+//
+struct spatial_hash {
+  using size_type = polyhedral_surface::size_type;
+  using cell = array<int64, 3>;
+
+  struct entry {
+    uint64 key;
+    size_type vid;
+    auto operator<=>(const entry&) const noexcept = default;
+  };
+
+  spatial_hash(const vector<polyhedral_surface::vertex>& vertices,
+               float32 epsilon);
+
+  static auto cell_of(vec3 p, float32 epsilon) noexcept -> cell {
+    p /= 2 * epsilon;
+    return {int64(std::floor(p.x)), int64(std::floor(p.y)),
+            int64(std::floor(p.z))};
+  }
+
+  auto cell_of(vec3 p) const noexcept -> cell { return cell_of(p, epsilon); }
+
+  // Get the keys of the eight cells nearest to the given position.
+  // With a cell size of twice the tolerance, these cells
+  // contain all positions that are at most 'epsilon' away.
+  //
+  static auto neighbor_keys(vec3 p, float32 epsilon) noexcept {
+    const auto c = cell_of(p, epsilon);
+    const auto q = p / (2 * epsilon);
+    const cell d{(q.x - c[0] < 0.5f) ? -1 : 1, (q.y - c[1] < 0.5f) ? -1 : 1,
+                 (q.z - c[2] < 0.5f) ? -1 : 1};
+    array<uint64, 8> keys;
+    for (int64 i = 0; i < 8; ++i)
+      keys[i] = key_of(cell{c[0] + ((i >> 0) & 1) * d[0],
+                            c[1] + ((i >> 1) & 1) * d[1],
+                            c[2] + ((i >> 2) & 1) * d[2]});
+    return keys;
+  }
+
+  static auto key_of(const cell& c) noexcept -> uint64 {
+    return mix(mix(mix(c[0]) ^ c[1]) ^ c[2]);
+  }
+
+  static auto key_of(vec3 p) noexcept -> uint64 {
+    // Make sure that positive and negative zero are equal.
+    p += vec3{0.0f};
+    array<uint32, 3> bits;
+    memcpy(bits.data(), &p, sizeof(bits));
+    return mix(mix((uint64(bits[0]) << 32) | bits[1]) ^ bits[2]);
+  }
+
+  auto key_of_vertex(size_type vid) const noexcept -> uint64 {
+    const auto p = vertices[vid].position;
+    return (epsilon > 0) ? key_of(cell_of(p)) : key_of(p);
+  }
+
+  auto shard_of(uint64 key) const noexcept -> size_t {
+    return key % shards;
+  }
+
+  // Call 'function(vid)' for every vertex stored with the given key.
+  // Every shard provides an open-addressing table with linear probing
+  // that maps a key to the start of its run of sorted entries.
+  //
+  void for_each(uint64 key, auto&& function) const {
+    const auto s = shard_of(key);
+    const auto mask = table_offsets[s + 1] - table_offsets[s] - 1;
+    for (auto slot = (key / shards) & mask;; slot = (slot + 1) & mask) {
+      const auto index = tables[table_offsets[s] + slot];
+      if (index == empty_slot) return;
+      if (entries[index].key != key) continue;
+      for (auto i = index; (i < entries.size()) && (entries[i].key == key);
+           ++i)
+        function(entries[i].vid);
+      return;
+    }
+  }
+
+  // Get the smallest vertex index that is close to the given one.
+  //
+  auto representative(size_type vid) const -> size_type {
+    const auto p = vertices[vid].position;
+    auto result = vid;
+    if (epsilon == 0) {
+      for_each(key_of(p), [&](size_type i) {
+        if (vertices[i].position + vec3{0.0f} == p + vec3{0.0f})
+          result = std::min(result, i);
+      });
+      return result;
+    }
+    const auto e2 = epsilon * epsilon;
+    for (auto key : neighbor_keys(p, epsilon))
+      for_each(key, [&](size_type i) {
+        if (length2(vertices[i].position - p) <= e2)
+          result = std::min(result, i);
+      });
+    return result;
+  }
+
+  const vector<polyhedral_surface::vertex>& vertices;
+  float32 epsilon;
+  size_t shards;
+  // Entries are sorted by shard, key, and vertex index.
+  vector<entry> entries{};
+  vector<size_t> offsets{};
+  //
+  static constexpr size_t empty_slot = -1;
+  vector<size_t> tables{};
+  vector<size_t> table_offsets{};
+};
+
+spatial_hash::spatial_hash(const vector<polyhedral_surface::vertex>& v,
+                           float32 e)
+    : vertices{v}, epsilon{e}, shards{4 * thread_count()} {
+  // Partition the vertices into shards by a parallel counting sort.
+  // Afterwards, every shard can be sorted independently.
+  //
+  const auto n = vertices.size();
+  const auto blocks = thread_count();
+  vector<size_t> counts(blocks * shards);
+  vector<uint64> keys(n);
+  parallel_invoke(blocks, [&](size_t b) {
+    const auto count = &counts[b * shards];
+    for (auto i = b * n / blocks; i < (b + 1) * n / blocks; ++i) {
+      keys[i] = key_of_vertex(i);
+      ++count[shard_of(keys[i])];
+    }
+  });
+
+  // Exclusive prefix sum in shard-major order.
+  //
+  offsets.assign(shards + 1, 0);
+  size_t sum = 0;
+  for (size_t s = 0; s < shards; ++s) {
+    offsets[s] = sum;
+    for (size_t b = 0; b < blocks; ++b) {
+      const auto count = counts[b * shards + s];
+      counts[b * shards + s] = sum;
+      sum += count;
+    }
+  }
+  offsets[shards] = sum;
+
+  entries.resize(n);
+  parallel_invoke(blocks, [&](size_t b) {
+    const auto cursor = &counts[b * shards];
+    for (auto i = b * n / blocks; i < (b + 1) * n / blocks; ++i)
+      entries[cursor[shard_of(keys[i])]++] = {keys[i], size_type(i)};
+  });
+
+  // Every table has a power-of-two size
+  // with at least twice as many slots as entries.
+  //
+  table_offsets.assign(shards + 1, 0);
+  for (size_t s = 0; s < shards; ++s)
+    table_offsets[s + 1] =
+        table_offsets[s] + bit_ceil(2 * (offsets[s + 1] - offsets[s]) + 1);
+  tables.assign(table_offsets.back(), empty_slot);
+
+  parallel_for(
+      0, shards,
+      [&](size_t s) {
+        sort(begin(entries) + offsets[s], begin(entries) + offsets[s + 1]);
+        const auto mask = table_offsets[s + 1] - table_offsets[s] - 1;
+        for (auto i = offsets[s]; i < offsets[s + 1]; ++i) {
+          if ((i > offsets[s]) && (entries[i - 1].key == entries[i].key))
+            continue;
+          auto slot = (entries[i].key / shards) & mask;
+          while (tables[table_offsets[s] + slot] != empty_slot)
+            slot = (slot + 1) & mask;
+          tables[table_offsets[s] + slot] = i;
+        }
+      },
+      1);
+}
+
+}  // namespace
+
+auto welded(const polyhedral_surface& surface, float32 epsilon)
+    -> polyhedral_surface {
+  using size_type = polyhedral_surface::size_type;
+  const auto n = surface.vertices.size();
+
+  // Map every vertex to its representative.
+  // As the representative of a vertex has a smaller or equal index,
+  // transitive chains can be resolved by a single ascending loop.
+  //
+  vector<size_type> ids(n);
+  {
+    const spatial_hash hash{surface.vertices, epsilon};
+    parallel_for(0, n, [&](size_t i) { ids[i] = hash.representative(i); });
+  }
+  for (size_t i = 0; i < n; ++i) ids[i] = ids[ids[i]];
+
+  // Enumerate all representatives in ascending order
+  // by using a parallel prefix sum over blocks.
+  //
+  const auto blocks = std::max(size_t{1}, std::min(thread_count(), n));
+  vector<size_type> block_offsets(blocks + 1);
+  parallel_invoke(blocks, [&](size_t b) {
+    size_type count = 0;
+    for (auto i = b * n / blocks; i < (b + 1) * n / blocks; ++i)
+      count += (ids[i] == i);
+    block_offsets[b + 1] = count;
+  });
+  inclusive_scan(begin(block_offsets), end(block_offsets),
+                 begin(block_offsets));
+
+  polyhedral_surface result{};
+  result.vertices.resize(block_offsets.back());
+  vector<size_type> new_ids(n);
+  parallel_invoke(blocks, [&](size_t b) {
+    auto id = block_offsets[b];
+    for (auto i = b * n / blocks; i < (b + 1) * n / blocks; ++i) {
+      if (ids[i] != i) continue;
+      new_ids[i] = id;
+      result.vertices[id++] = surface.vertices[i];
+    }
+  });
+  parallel_for(0, n, [&](size_t i) { ids[i] = new_ids[ids[i]]; });
+
+  // Remap all faces and remove the ones
+  // that degenerated to edges or points.
+  //
+  const auto m = surface.faces.size();
+  const auto face_blocks = std::max(size_t{1}, std::min(thread_count(), m));
+  vector<size_t> face_offsets(face_blocks + 1);
+  const auto degenerate = [](const polyhedral_surface::face& f) {
+    return (f[0] == f[1]) || (f[1] == f[2]) || (f[2] == f[0]);
+  };
+  const auto remap = [&](polyhedral_surface::face f) {
+    for (auto& vid : f) vid = ids[vid];
+    return f;
+  };
+  parallel_invoke(face_blocks, [&](size_t b) {
+    size_t count = 0;
+    for (auto i = b * m / face_blocks; i < (b + 1) * m / face_blocks; ++i)
+      count += !degenerate(remap(surface.faces[i]));
+    face_offsets[b + 1] = count;
+  });
+  inclusive_scan(begin(face_offsets), end(face_offsets), begin(face_offsets));
+  result.faces.resize(face_offsets.back());
+  parallel_invoke(face_blocks, [&](size_t b) {
+    auto fid = face_offsets[b];
+    for (auto i = b * m / face_blocks; i < (b + 1) * m / face_blocks; ++i) {
+      const auto f = remap(surface.faces[i]);
+      if (!degenerate(f)) result.faces[fid++] = f;
+    }
+  });
+
+  compute_vertex_normals(result);
+  return result;
+}
+
+void streaming_welder::insert(span<const stl_surface::triangle> triangles) {
+  for (const auto& t : triangles) {
+    const polyhedral_surface::face f{
+        vertex_id(t.vertex[0]), vertex_id(t.vertex[1]), vertex_id(t.vertex[2])};
+    corners += 3;
+    if ((f[0] == f[1]) || (f[1] == f[2]) || (f[2] == f[0])) continue;
+    result.faces.push_back(f);
+  }
+}
+
+auto streaming_welder::vertex_id(vec3 position) -> size_type {
+  const auto mask = table.size() - 1;
+  const auto find = [&](uint64 key) -> const slot* {
+    if (table.empty()) return nullptr;
+    for (auto i = key & mask;; i = (i + 1) & mask) {
+      if (table[i].head == empty_slot) return nullptr;
+      if (table[i].key == key) return &table[i];
+    }
+  };
+
+  // Search for an already inserted vertex.
+  //
+  auto vid = empty_slot;
+  const auto& v = result.vertices;
+  if (epsilon == 0) {
+    if (const auto s = find(spatial_hash::key_of(position))) {
+      for (auto i = s->head; i != empty_slot; i = next[i])
+        if (v[i].position + vec3{0.0f} == position + vec3{0.0f}) return i;
+    }
+  } else {
+    const auto e2 = epsilon * epsilon;
+    for (auto key : spatial_hash::neighbor_keys(position, epsilon)) {
+      const auto s = find(key);
+      if (!s) continue;
+      for (auto i = s->head; i != empty_slot; i = next[i])
+        if (length2(v[i].position - position) <= e2) vid = std::min(vid, i);
+    }
+    if (vid != empty_slot) return vid;
+  }
+
+  // Otherwise, add a new vertex.
+  //
+  vid = result.vertices.size();
+  result.vertices.push_back({.position = position, .normal = {}});
+  next.push_back(empty_slot);
+  if (2 * result.vertices.size() > table.size())
+    rehash();
+  else
+    insert(vid);
+  return vid;
+}
+
+void streaming_welder::insert(size_type vid) {
+  const auto p = result.vertices[vid].position;
+  const auto key = (epsilon == 0) ? spatial_hash::key_of(p)
+                                  : spatial_hash::key_of(
+                                        spatial_hash::cell_of(p, epsilon));
+  const auto mask = table.size() - 1;
+  auto i = key & mask;
+  while ((table[i].head != empty_slot) && (table[i].key != key))
+    i = (i + 1) & mask;
+  // Vertices are prepended to the chain of their key.
+  table[i].key = key;
+  next[vid] = table[i].head;
+  table[i].head = vid;
+}
+
+void streaming_welder::rehash() {
+  const auto size = std::max(size_t{1} << 10, 4 * result.vertices.size());
+  table.assign(bit_ceil(size), {});
+  for (size_type vid = 0; vid < result.vertices.size(); ++vid) insert(vid);
+}
+
+auto streaming_welder::surface() && -> polyhedral_surface {
+  table = {};
+  next = {};
+  compute_vertex_normals(result);
+  return std::move(result);
+}
+
+auto welded_stl_surface_from(const filesystem::path& path, float32 epsilon)
+    -> welded_stl_surface {
+  streaming_welder welder{epsilon};
+  stl_surface::for_each_batch(
+      path, [&](span<const stl_surface::triangle> triangles) {
+        welder.insert(triangles);
+      });
+  const auto corners = welder.corner_count();
+  return {std::move(welder).surface(), corners};
+}
+
+}  // namespace hyperreflex
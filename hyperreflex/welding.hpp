@@ -0,0 +1,74 @@
+#pragma once
+#include <hyperreflex/polyhedral_surface.hpp>
+
+namespace hyperreflex {
+
+/// Merge all vertices of a surface whose positions are equal
+/// or, for a positive 'epsilon', whose distance is at most 'epsilon'.
+/// Every merged vertex is represented by the vertex with the smallest index.
+/// Faces that degenerate due to the merge are removed.
+/// Vertex normals are recomputed from area-weighted face normals.
+/// All stages run in parallel and the result is deterministic.
+///
+auto welded(const polyhedral_surface& surface, float32 epsilon = 0)
+    -> polyhedral_surface;
+
+/// Incremental welding of triangle batches streamed from a file.
+/// Only the welded output and a hash table are kept in memory.
+/// For a positive 'epsilon', a new vertex is merged
+/// with the oldest vertex that is at most 'epsilon' away.
+///
+class streaming_welder {
+ public:
+  using size_type = polyhedral_surface::size_type;
+
+  streaming_welder(float32 epsilon = 0) noexcept : epsilon{epsilon} {}
+
+  void insert(span<const stl_surface::triangle> triangles);
+
+  /// Number of all inserted triangle corners before welding.
+  ///
+  auto corner_count() const noexcept { return corners; }
+
+  /// Finish the welding by computing vertex normals.
+  ///
+  auto surface() && -> polyhedral_surface;
+
+ private:
+  auto vertex_id(vec3 position) -> size_type;
+  void insert(size_type vid);
+  void rehash();
+
+  static constexpr size_type empty_slot = -1;
+  struct slot {
+    uint64 key;
+    size_type head = empty_slot;
+  };
+
+  float32 epsilon;
+  size_t corners = 0;
+  polyhedral_surface result{};
+  // Vertices with the same key are linked to each other.
+  vector<size_type> next{};
+  vector<slot> table{};
+};
+
+/// STL files of at least this size should be streamed and welded on the fly
+/// to not need the memory for the unwelded triangles.
+///
+constexpr uintmax_t stl_streaming_threshold = uintmax_t{1} << 30;
+
+/// Welded surface of a streamed STL file
+///
+struct welded_stl_surface {
+  polyhedral_surface surface{};
+  // Number of all triangle corners in the file before welding
+  size_t corner_count{};
+};
+
+/// Stream and weld an STL file without ever storing all unwelded triangles.
+///
+auto welded_stl_surface_from(const filesystem::path& path, float32 epsilon = 0)
+    -> welded_stl_surface;
+
+}  // namespace hyperreflex